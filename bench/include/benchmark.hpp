@@ -0,0 +1,65 @@
+//
+// ChameleonGL - A small framework for OpenGL.
+// Copyright (C) 2012-2017 Srinivas Kaza
+//
+// This file is part of ChameleonGL.
+//
+// ChameleonGL is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ChameleonGL is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ChameleonGL.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <chrono>
+#include <unordered_map>
+
+#include "SDL2/SDL.h"
+
+#include "null_event_handler.hpp"
+#include "sdl_helpers.hpp"
+
+// Options for a small GraphicsContext that is only used to issue GL calls
+inline std::unordered_map<std::string, void*> benchmark_options() {
+    static int width = 64;
+    static int height = 64;
+    static std::string version = "4.3";
+
+    std::unordered_map<std::string, void*> options;
+    options["width"] = &width;
+    options["height"] = &height;
+    options["opengl_version"] = &version;
+    return options;
+}
+
+/**
+ * Calls {@code body(i)} for i in [0, iterations) and returns the mean
+ * wall-clock cost of one call in nanoseconds
+ */
+template <typename F>
+inline double time_per_iteration(const size_t& iterations, F body) {
+    auto start = std::chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < iterations; i++) {
+        body(i);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>
+           (end - start).count() / (double) iterations;
+}
+
+inline void report(const std::string& name, const double& value,
+                   const std::string& unit = "ns") {
+    std::cout << name << ": " << value << " " << unit << "\n";
+}
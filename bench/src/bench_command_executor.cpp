@@ -0,0 +1,132 @@
+//
+// ChameleonGL - A small framework for OpenGL.
+// Copyright (C) 2012-2017 Srinivas Kaza
+//
+// This file is part of ChameleonGL.
+//
+// ChameleonGL is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ChameleonGL is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ChameleonGL.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include <vector>
+#include <memory>
+#include <typeinfo>
+
+#include "chameleon_gl.hpp"
+#include "graphics_context.hpp"
+#include "command.hpp"
+#include "command_executor.hpp"
+#include "render_state.hpp"
+#include "benchmark.hpp"
+
+STATIC_INIT()
+
+static size_t executed = 0;
+
+// Stands in for a draw: carries a render state but issues no GL calls, so
+// that only the executor's dispatch and state diffing is measured
+class SyntheticDraw : public Command {
+  public:
+    explicit SyntheticDraw(const RenderState& render_state) :
+        _render_state(render_state) {
+
+    }
+
+    void operator()() override {
+        executed++;
+    }
+
+    const RenderState* get_render_state() const override {
+        return &_render_state;
+    }
+
+    RenderState copy_render_state() const {
+        return _render_state;
+    }
+
+  private:
+    RenderState _render_state;
+};
+
+class SyntheticClear : public Command {
+  public:
+    void operator()() override {
+        executed++;
+    }
+};
+
+// The typeid-based loop GraphicsContext::mainloop used before commands
+// carried a type tag and exposed their render state by pointer
+void legacy_execute(RenderState& render_state, const CommandList& commands) {
+    for (auto command : commands) {
+        if (typeid(*command) == typeid(SyntheticDraw)) {
+            auto draw_command =
+                std::static_pointer_cast<SyntheticDraw>(command);
+            auto new_render_state = draw_command->copy_render_state();
+            render_state.apply_diff(new_render_state);
+            render_state = new_render_state;
+        }
+        (*command)();
+    }
+}
+
+CommandList synthetic_commands(const size_t& count) {
+    RenderState opaque({GL_MULTISAMPLE, GL_DITHER, GL_DEPTH_TEST, GL_CULL_FACE});
+    RenderState blended({GL_MULTISAMPLE, GL_DITHER, GL_DEPTH_TEST, GL_BLEND});
+    blended.set_param(BlendFunction({UINT_MAX,
+                                     GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA,
+                                     GL_ONE, GL_ZERO}));
+
+    CommandList commands;
+    commands.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        if (i % 10 == 0) {
+            commands.push_back(CommandPtr(new SyntheticClear()));
+        } else if (i % 10 < 8) {
+            commands.push_back(CommandPtr(new SyntheticDraw(opaque)));
+        } else {
+            commands.push_back(CommandPtr(new SyntheticDraw(blended)));
+        }
+    }
+    return commands;
+}
+
+int main(int argc, char** args) {
+    NullEventHandler handler;
+    GraphicsContext context(handler, benchmark_options());
+
+    const size_t num_commands = 100000;
+    const size_t repetitions = 10;
+    CommandList commands = synthetic_commands(num_commands);
+
+    RenderState legacy_state;
+    double legacy_ns = time_per_iteration(repetitions,
+    [&legacy_state, &commands](size_t) {
+        legacy_execute(legacy_state, commands);
+    });
+    glFinish();
+
+    CommandExecutor executor;
+    double executor_ns = time_per_iteration(repetitions,
+    [&executor, &commands](size_t) {
+        executor.execute(commands);
+    });
+    glFinish();
+
+    report("typeid dispatch (before)", legacy_ns / num_commands,
+           "ns/command");
+    report("CommandExecutor (after)", executor_ns / num_commands,
+           "ns/command");
+    report("Commands executed", executed, "");
+}
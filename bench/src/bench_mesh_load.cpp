@@ -0,0 +1,81 @@
+//
+// ChameleonGL - A small framework for OpenGL.
+// Copyright (C) 2012-2017 Srinivas Kaza
+//
+// This file is part of ChameleonGL.
+//
+// ChameleonGL is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ChameleonGL is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ChameleonGL.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include <string>
+#include <cstdio>
+#include <cstdlib>
+#include <sys/stat.h>
+
+#include "chameleon_gl.hpp"
+#include "mesh.hpp"
+#include "mesh_file.hpp"
+#include "benchmark.hpp"
+
+STATIC_INIT()
+
+// CPU cost of loading a mesh (assets/sculpt.obj by default), both from the
+// OBJ text and from its binary conversion. Nothing is uploaded, so no GL
+// context is needed.
+int main(int argc, char** args) {
+    std::string filename = argc > 1 ? args[1] : "assets/sculpt.obj";
+    std::string converted = "bench_mesh_load.mesh";
+    const size_t repetitions = 10;
+
+    struct stat st;
+    if (stat(filename.c_str(), &st) != 0) {
+        std::cerr << "Could not find " << filename << std::endl;
+        return 1;
+    }
+
+    MeshData data;
+    double parse_ns = time_per_iteration(repetitions,
+    [&filename, &data](size_t) {
+        data = Mesh::parse_obj(filename);
+    });
+
+    if (!MeshFile::write(converted, data, st.st_size, st.st_mtime)) {
+        std::cerr << "Could not write " << converted << std::endl;
+        return 1;
+    }
+
+    size_t mapped_bytes = 0;
+    double map_ns = time_per_iteration(repetitions,
+    [&converted, &mapped_bytes](size_t) {
+        MeshFile file;
+        if (!file.open(converted)) {
+            std::cerr << "Could not open " << converted << std::endl;
+            std::remove(converted.c_str());
+            std::exit(1);
+        }
+        // Touch the data as an upload would
+        const uint8_t* vertices = (const uint8_t*) file.vertex_data();
+        size_t size = (size_t) file.num_vertices() * file.vertex_size();
+        for (size_t i = 0; i < size; i += 4096) {
+            mapped_bytes += vertices[i];
+        }
+    });
+    std::remove(converted.c_str());
+
+    report("Mesh::parse_obj", parse_ns * 1e-6, "ms");
+    report("MeshFile::open", map_ns * 1e-6, "ms");
+    report("Vertices", data.num_vertices, "");
+    report("Indices", data.num_indices, "");
+}
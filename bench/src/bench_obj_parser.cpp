@@ -0,0 +1,60 @@
+//
+// ChameleonGL - A small framework for OpenGL.
+// Copyright (C) 2012-2017 Srinivas Kaza
+//
+// This file is part of ChameleonGL.
+//
+// ChameleonGL is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ChameleonGL is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ChameleonGL.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include <string>
+#include <thread>
+#include <sys/stat.h>
+
+#include "obj_parser.hpp"
+#include "benchmark.hpp"
+
+// Parses an OBJ file (assets/sculpt.obj by default) with tinyobj and with
+// ObjParser, and reports both in MB/s
+int main(int argc, char** args) {
+    std::string filename = argc > 1 ? args[1] : "assets/sculpt.obj";
+    const size_t repetitions = 10;
+
+    struct stat st;
+    if (stat(filename.c_str(), &st) != 0) {
+        std::cerr << "Could not find " << filename << std::endl;
+        return 1;
+    }
+    double megabytes = st.st_size / (1024.0 * 1024.0);
+
+    size_t reference_indices = 0;
+    double reference_ns = time_per_iteration(repetitions,
+    [&filename, &reference_indices](size_t) {
+        reference_indices = ObjParser::parse_reference(filename).indices.size();
+    });
+
+    size_t parallel_indices = 0;
+    double parallel_ns = time_per_iteration(repetitions,
+    [&filename, &parallel_indices](size_t) {
+        parallel_indices = ObjParser::parse(filename).indices.size();
+    });
+
+    report("tinyobj::LoadObj (before)", megabytes / (reference_ns * 1e-9),
+           "MB/s");
+    report("ObjParser::parse (after)", megabytes / (parallel_ns * 1e-9),
+           "MB/s");
+    report("Threads", std::thread::hardware_concurrency(), "");
+    report("Indices match", reference_indices == parallel_indices, "");
+}
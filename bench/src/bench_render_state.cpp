@@ -0,0 +1,220 @@
+//
+// ChameleonGL - A small framework for OpenGL.
+// Copyright (C) 2012-2017 Srinivas Kaza
+//
+// This file is part of ChameleonGL.
+//
+// ChameleonGL is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ChameleonGL is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ChameleonGL.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include <unordered_set>
+#include <unordered_map>
+#include <functional>
+#include <vector>
+
+#include "chameleon_gl.hpp"
+#include "graphics_context.hpp"
+#include "render_state.hpp"
+#include "benchmark.hpp"
+
+STATIC_INIT()
+
+// The closure-map RenderState that predates the typed state block. Kept here
+// only as the "before" measurement; it rebuilds its default state and
+// re-issues every parameter on each diff.
+class LegacyRenderState {
+  public:
+    explicit LegacyRenderState(
+        std::unordered_set<GLenum> enabled =
+            std::unordered_set<GLenum>({GL_MULTISAMPLE, GL_DITHER})) :
+        _enabled(new std::unordered_set<GLenum>(enabled)),
+        _params(new std::unordered_map<std::string,
+                std::function<void()>>()) {
+    }
+
+    void set_param(const BlendFunction& v) {
+        (*_params)["blend_function"] = [v]() {
+            glBlendFuncSeparate(v.src_RGB, v.dst_RGB,
+                                v.src_alpha, v.dst_alpha);
+        };
+    }
+    void set_param(const BlendEquation& v) {
+        (*_params)["blend_equation"] = [v]() {
+            glBlendEquationSeparate(v.mode_RGB, v.mode_alpha);
+        };
+    }
+    void set_param(const LogicalOperation& v) {
+        (*_params)["logical_operation"] = [v]() { glLogicOp(v.opcode); };
+    }
+    void set_param(const CullFace& v) {
+        (*_params)["cull_face"] = [v]() { glCullFace(v.mode); };
+    }
+    void set_param(const DepthRange& v) {
+        (*_params)["depth_range"] = [v]() {
+            glDepthRange(v.range[0], v.range[1]);
+        };
+    }
+    void set_param(const DepthFunction& v) {
+        (*_params)["depth_function"] = [v]() { glDepthFunc(v.mode); };
+    }
+    void set_param(const LineWidth& v) {
+        (*_params)["line_width"] = [v]() { glLineWidth(v.width); };
+    }
+    void set_param(const PointSize& v) {
+        (*_params)["point_size"] = [v]() { glPointSize(v.size); };
+    }
+    void set_param(const SampleCoverage& v) {
+        (*_params)["sample_coverage"] = [v]() {
+            glSampleCoverage(v.value, v.invert);
+        };
+    }
+    void set_param(const PolygonOffset& v) {
+        (*_params)["polygon_offset"] = [v]() {
+            glPolygonOffset(v.factor, v.units);
+        };
+    }
+    void set_param(const PolygonMode& v) {
+        (*_params)["polygon_mode"] = [v]() { glPolygonMode(v.face, v.mode); };
+    }
+    void set_param(const PrimitiveRestartIndex& v) {
+        (*_params)["primitive_restart_index"] = [v]() {
+            glPrimitiveRestartIndex(v.index);
+        };
+    }
+    void set_param(const MinSampleShading& v) {
+        (*_params)["min_sample_shading"] = [v]() {
+            glMinSampleShading(v.value);
+        };
+    }
+    void set_param(const SampleMask& v) {
+        (*_params)["sample_mask"] = [v]() {
+            glSampleMaski(v.mask_number, v.mask);
+        };
+    }
+    void set_param(const ScissorBox& v) {
+        (*_params)["scissor_box"] = [v]() {
+            glScissor(v.box[0], v.box[1], v.box[2], v.box[3]);
+        };
+    }
+    void set_param(const StencilFunction& v) {
+        (*_params)["stencil_function"] = [v]() {
+            glStencilFunc(v.func, v.ref, v.mask);
+        };
+    }
+    void set_param(const StencilOperation& v) {
+        (*_params)["stencil_operation"] = [v]() {
+            glStencilOp(v.sfail, v.dpfail, v.dppass);
+        };
+    }
+
+    void apply_diff(const LegacyRenderState& second) const {
+        LegacyRenderState default_state = construct_default_state();
+
+        for (auto first_enabled : *_enabled) {
+            if (!second._enabled->count(first_enabled)) {
+                glDisable(first_enabled);
+            }
+        }
+        for (auto second_enabled : *(second._enabled)) {
+            if (!_enabled->count(second_enabled)) {
+                glEnable(second_enabled);
+            }
+        }
+        for (auto& param : *(second._params)) {
+            param.second();
+        }
+        for (auto& param : *_params) {
+            if (!second._params->count(param.first)) {
+                default_state._params->at(param.first)();
+            }
+        }
+    }
+
+  private:
+    static LegacyRenderState construct_default_state() {
+        LegacyRenderState default_state;
+
+        default_state.set_param(BlendFunction());
+        default_state.set_param(BlendEquation());
+        default_state.set_param(SampleCoverage());
+        default_state.set_param(PolygonOffset());
+        default_state.set_param(PolygonMode());
+        default_state.set_param(SampleMask());
+        default_state.set_param(StencilFunction());
+        default_state.set_param(StencilOperation());
+        default_state.set_param(LogicalOperation());
+        default_state.set_param(CullFace());
+        default_state.set_param(DepthRange());
+        default_state.set_param(DepthFunction());
+        default_state.set_param(LineWidth());
+        default_state.set_param(PointSize());
+        default_state.set_param(PrimitiveRestartIndex());
+        default_state.set_param(MinSampleShading());
+        default_state.set_param(ScissorBox());
+
+        return default_state;
+    }
+
+    std::shared_ptr<std::unordered_set<GLenum>> _enabled;
+    std::shared_ptr<std::unordered_map<std::string,
+        std::function<void()>>> _params;
+};
+
+// Builds the same handful of states that a typical scene cycles through:
+// opaque geometry, a repeated opaque draw, alpha blended geometry and a
+// fullscreen pass
+template <typename State>
+std::vector<State> scene_states() {
+    State opaque({GL_MULTISAMPLE, GL_DITHER, GL_DEPTH_TEST, GL_CULL_FACE});
+    opaque.set_param(DepthFunction({GL_LESS}));
+    opaque.set_param(CullFace({GL_BACK}));
+
+    State blended({GL_MULTISAMPLE, GL_DITHER, GL_DEPTH_TEST, GL_BLEND});
+    blended.set_param(DepthFunction({GL_LEQUAL}));
+    blended.set_param(BlendFunction({UINT_MAX,
+                                     GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA,
+                                     GL_ONE, GL_ZERO}));
+
+    State fullscreen({GL_MULTISAMPLE, GL_DITHER});
+    fullscreen.set_param(DepthFunction({GL_LESS}));
+
+    return std::vector<State>({opaque, opaque, blended, fullscreen});
+}
+
+template <typename State>
+double transition_cost(const size_t& iterations) {
+    std::vector<State> states = scene_states<State>();
+    double ns = time_per_iteration(iterations, [&states](size_t i) {
+        states[i % states.size()].apply_diff(
+            states[(i + 1) % states.size()]);
+    });
+    glFinish();
+    return ns;
+}
+
+int main(int argc, char** args) {
+    NullEventHandler handler;
+    GraphicsContext context(handler, benchmark_options());
+
+    const size_t iterations = 100000;
+
+    // Warm up the driver before measuring either implementation
+    transition_cost<RenderState>(iterations / 10);
+
+    report("Closure map RenderState::apply_diff (before)",
+           transition_cost<LegacyRenderState>(iterations));
+    report("Typed RenderState::apply_diff (after)",
+           transition_cost<RenderState>(iterations));
+}
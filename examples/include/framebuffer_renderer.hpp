@@ -59,46 +59,35 @@ class FramebufferRenderer : public Renderer {
         render_state.set_param(DepthFunction({GL_LESS}));
     }
 
-    virtual CommandList operator()(AbstractSurfacePtr surface) override {
+    virtual void record(AbstractSurfacePtr surface,
+                        FrameCommandList& commands) override {
         // Some ugly boilerplate rquired to request (and update) a framebuffer
         int width = surface->get_width();
         int height = surface->get_height();
         if (fbo->get_width() < 0) {
             fbo->on_resize(width, height);
             fbo->typical_fbo();
-        }
 
-        CommandList commands;
+            // Binds the framebuffer's color attachment backing texture to a
+            // uniform map
+            map.set("tex"_u, fbo->get_texture("color"));
+        }
 
         // Adds command to clear screen
-        commands.push_back(CommandPtr(new ClearCommand({
-            surface,
-            ClearCommand::CLEAR_COLOR |
-            ClearCommand::CLEAR_DEPTH,
-            glm::vec4(0.0)
-        })));
+        commands.emplace<ClearCommand>(surface,
+                                       ClearCommand::CLEAR_COLOR |
+                                       ClearCommand::CLEAR_DEPTH,
+                                       glm::vec4(0.0));
 
         // Append the commands of the inner rendering operation to the list
-        auto nested_commands = renderer(fbo);
-        commands.insert(commands.end(),
-                        nested_commands.begin(),
-                        nested_commands.end());
-
-        // Binds the framebuffer's color attachment backing texture to a uniform
-        // map
-        UniformMap map;
-        map.set("tex", fbo->get_texture("color"));
+        renderer.record(fbo, commands);
 
         // Draw to fullscreen quad
-        commands.push_back(CommandPtr(new DrawCommand({
-            quad,
-            program,
-            surface,
-            map,
-            render_state
-        })));
-
-        return commands;
+        commands.emplace<DrawCommand>(quad,
+                                      program,
+                                      surface,
+                                      map,
+                                      render_state);
     }
   private:
     Program program;
@@ -107,4 +96,5 @@ class FramebufferRenderer : public Renderer {
     Renderer& renderer;
     Mesh quad;
     RenderState render_state;
+    UniformMap map;
 };
@@ -68,7 +68,8 @@ class ConwayLifeRenderer : public Renderer {
         render_state.set_param(DepthFunction({GL_LESS}));
     }
 
-    virtual CommandList operator()(AbstractSurfacePtr surface) override {
+    virtual void record(AbstractSurfacePtr surface,
+                        FrameCommandList& commands) override {
         int width = surface->get_width();
         int height = surface->get_height();
         if (fbo.first->get_width() < 0 ||
@@ -101,40 +102,43 @@ class ConwayLifeRenderer : public Renderer {
             fbo.second->bind_textures(std::unordered_map<std::string, Texture> {
                 {"color", texture_2}
             });
+
+            // Uniform maps for both ping-pong directions, reused every frame
+            update_maps.first.set("prior"_u, fbo.second->get_texture("color"));
+            update_maps.second.set("prior"_u, fbo.first->get_texture("color"));
+            render_maps.first.set("tex"_u, fbo.first->get_texture("color"));
+            render_maps.second.set("tex"_u, fbo.second->get_texture("color"));
         }
 
         bool ping_pong = (frame_count++ % 4 < 2);
 
-        FramebufferPtr update_surface = (ping_pong) ? fbo.first : fbo.second;
-        FramebufferPtr other_surface = (ping_pong) ? fbo.second : fbo.first;
-
-        UniformMap map;
-        map.set("prior", other_surface->get_texture("color"));
-
-        CommandPtr clear_screen(new ClearCommand(surface,
-                                ClearCommand::CLEAR_COLOR |
-                                ClearCommand::CLEAR_DEPTH,
-                                glm::vec4(0.0)));
-        CommandPtr clear_fbo(new ClearCommand(update_surface,
-                                              ClearCommand::CLEAR_COLOR |
-                                              ClearCommand::CLEAR_DEPTH,
-                                              glm::vec4(0.0)));
-
-        CommandPtr update(new DrawCommand(quad,
-                                          program,
-                                          update_surface,
-                                          map,
-                                          render_state));
-
-        UniformMap render_map;
-        render_map.set("tex", update_surface->get_texture("color"));
-        CommandPtr render(new DrawCommand(quad,
-                                          texture_program,
-                                          surface,
-                                          render_map,
-                                          render_state));
-
-        return CommandList({clear_screen, clear_fbo, update, render});
+        const FramebufferPtr& update_surface =
+            (ping_pong) ? fbo.first : fbo.second;
+        const UniformMap& map =
+            (ping_pong) ? update_maps.first : update_maps.second;
+        const UniformMap& render_map =
+            (ping_pong) ? render_maps.first : render_maps.second;
+
+        commands.emplace<ClearCommand>(surface,
+                                       ClearCommand::CLEAR_COLOR |
+                                       ClearCommand::CLEAR_DEPTH,
+                                       glm::vec4(0.0));
+        commands.emplace<ClearCommand>(update_surface,
+                                       ClearCommand::CLEAR_COLOR |
+                                       ClearCommand::CLEAR_DEPTH,
+                                       glm::vec4(0.0));
+
+        commands.emplace<DrawCommand>(quad,
+                                      program,
+                                      update_surface,
+                                      map,
+                                      render_state);
+
+        commands.emplace<DrawCommand>(quad,
+                                      texture_program,
+                                      surface,
+                                      render_map,
+                                      render_state);
     }
 
   private:
@@ -162,6 +166,8 @@ class ConwayLifeRenderer : public Renderer {
     Program texture_program;
     Mesh quad;
     std::pair<FramebufferPtr, FramebufferPtr> fbo;
+    std::pair<UniformMap, UniformMap> update_maps;
+    std::pair<UniformMap, UniformMap> render_maps;
     RenderState render_state;
     int frame_count;
 };
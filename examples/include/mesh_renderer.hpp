@@ -53,19 +53,18 @@ class MeshRenderer : public Renderer {
         render_state.set_param(CullFace({GL_BACK}));
     }
 
-    virtual CommandList operator()(AbstractSurfacePtr surface) override {
-        CommandPtr clear(new ClearCommand(surface,
-                                          ClearCommand::CLEAR_COLOR |
-                                          ClearCommand::CLEAR_DEPTH,
-                                          glm::vec4(0.0)));
+    virtual void record(AbstractSurfacePtr surface,
+                        FrameCommandList& commands) override {
+        commands.emplace<ClearCommand>(surface,
+                                       ClearCommand::CLEAR_COLOR |
+                                       ClearCommand::CLEAR_DEPTH,
+                                       glm::vec4(0.0));
 
-        CommandPtr mesh_draw(new DrawCommand(
-                                 mesh,
-                                 program,
-                                 surface,
-                                 UniformMap(),
-                                 render_state));
-        return CommandList({clear, mesh_draw});
+        commands.emplace<DrawCommand>(mesh,
+                                      program,
+                                      surface,
+                                      UniformMap(),
+                                      render_state);
     }
   private:
     Program program;
@@ -62,20 +62,18 @@ class PointCloudExampleRenderer : public Renderer {
         render_state.set_param(DepthFunction({GL_LESS}));
     }
 
-    virtual CommandList operator()(AbstractSurfacePtr surface) override {
-        CommandPtr clear_screen(new ClearCommand(surface,
-                                ClearCommand::CLEAR_COLOR |
-                                ClearCommand::CLEAR_DEPTH,
-                                glm::vec4(0.0)));
+    virtual void record(AbstractSurfacePtr surface,
+                        FrameCommandList& commands) override {
+        commands.emplace<ClearCommand>(surface,
+                                       ClearCommand::CLEAR_COLOR |
+                                       ClearCommand::CLEAR_DEPTH,
+                                       glm::vec4(0.0));
 
-        UniformMap render_map;
-        CommandPtr render(new DrawCommand(point_cloud,
-                                          program,
-                                          surface,
-                                          render_map,
-                                          render_state));
-
-        return CommandList({clear_screen, render});
+        commands.emplace<DrawCommand>(point_cloud,
+                                      program,
+                                      surface,
+                                      UniformMap(),
+                                      render_state);
     }
 
   private:
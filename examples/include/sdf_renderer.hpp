@@ -37,38 +37,56 @@ class SDFRenderer : public Renderer {
   public:
     explicit SDFRenderer(InputController& controller) :
         program(),
+        fallback(),
         mesh(),
         ctrl(controller),
         render_state( {
         GL_MULTISAMPLE, GL_DITHER, GL_DEPTH_TEST
     }) {
-        program.compile_shader("examples/shaders/sdf_shader.vs", GL_VERTEX_SHADER,
-                               true, true);
-        program.compile_shader("examples/shaders/sdf_shader.fs", GL_FRAGMENT_SHADER,
-                               true, true);
-        program.link_program();
+        program.add_shader("examples/shaders/sdf_shader.vs", GL_VERTEX_SHADER);
+        program.add_shader("examples/shaders/sdf_shader.fs", GL_FRAGMENT_SHADER);
+        program.link_program_async();
+
+        // Drawn in flat grey while the SDF shader is still compiling
+        fallback.add_shader("examples/shaders/sdf_shader.vs",
+                            GL_VERTEX_SHADER);
+        fallback.add_shader(FALLBACK_FRAGMENT_SHADER, GL_FRAGMENT_SHADER,
+                            false);
+        fallback.link_program();
 
         mesh = Mesh::construct_fullscreen_quad();
 
         render_state.set_param(DepthFunction({GL_LESS}));
     }
 
-    virtual CommandList operator()(AbstractSurfacePtr surface) override {
-        CommandPtr clear(new ClearCommand(surface,
-                                          ClearCommand::CLEAR_COLOR |
-                                          ClearCommand::CLEAR_DEPTH,
-                                          glm::vec4(0.0)));
+    virtual void record(AbstractSurfacePtr surface,
+                        FrameCommandList& commands) override {
+        commands.emplace<ClearCommand>(surface,
+                                       ClearCommand::CLEAR_COLOR |
+                                       ClearCommand::CLEAR_DEPTH,
+                                       glm::vec4(0.0));
+
+        commands.emplace<DrawCommand>(mesh,
+                                      program.ready_or(fallback),
+                                      surface,
+                                      UniformMap(),
+                                      render_state);
+    }
 
-        CommandPtr sdf_draw(new DrawCommand(mesh,
-                                            program,
-                                            surface,
-                                            UniformMap(),
-                                            render_state));
-        return CommandList({clear, sdf_draw});
+    Program& get_program() {
+        return program;
     }
 
   private:
+    constexpr static const char* FALLBACK_FRAGMENT_SHADER =
+        "#version 430 core\n"
+        "out vec4 color;\n"
+        "void main() {\n"
+        "    color = vec4(0.5, 0.5, 0.5, 1.0);\n"
+        "}\n";
+
     Program program;
+    Program fallback;
     Mesh mesh;
     InputController& ctrl;
     RenderState render_state;
@@ -52,23 +52,23 @@ class TextureRenderer : public Renderer {
         quad = Mesh::construct_fullscreen_quad();
 
         render_state.set_param(DepthFunction({GL_LESS}));
-    }
 
-    virtual CommandList operator()(AbstractSurfacePtr surface) override {
-        UniformMap map;
-        map.set("tex", texture);
+        // Built once; every frame's DrawCommand shares it
+        map.set("tex"_u, texture);
+    }
 
-        CommandPtr clear(new ClearCommand(surface,
-                                          ClearCommand::CLEAR_COLOR |
-                                          ClearCommand::CLEAR_DEPTH,
-                                          glm::vec4(0.0)));
+    virtual void record(AbstractSurfacePtr surface,
+                        FrameCommandList& commands) override {
+        commands.emplace<ClearCommand>(surface,
+                                       ClearCommand::CLEAR_COLOR |
+                                       ClearCommand::CLEAR_DEPTH,
+                                       glm::vec4(0.0));
 
-        CommandPtr tex_draw(new DrawCommand(quad,
-                                            program,
-                                            surface,
-                                            map,
-                                            render_state));
-        return CommandList({clear, tex_draw});
+        commands.emplace<DrawCommand>(quad,
+                                      program,
+                                      surface,
+                                      map,
+                                      render_state);
     }
 
   private:
@@ -76,4 +76,5 @@ class TextureRenderer : public Renderer {
     Mesh quad;
     Texture& texture;
     RenderState render_state;
+    UniformMap map;
 };
@@ -22,7 +22,14 @@
 out vec3 color;
 
 uniform sampler2D prior;
-uniform vec4 chml_viewport;
+layout(std140) uniform chml_frame {
+    mat4 chml_view;
+    mat4 chml_projection;
+    mat4 chml_inverse_view_projection;
+    vec4 chml_viewport;
+    vec3 chml_origin;
+    float chml_near;
+};
 
 #define SCREEN_NORM(a) (a) / chml_viewport.zw
 #define FETCH(pos) texture(prior, SCREEN_NORM(vec2(pos) + gl_FragCoord.xy)).r
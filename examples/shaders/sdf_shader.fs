@@ -21,11 +21,14 @@
 #version 430 core
 out vec3 color;
 
-uniform vec3 chml_origin;
-uniform mat4 chml_inverse_view_projection;
-uniform vec4 chml_viewport;
-
-uniform float chml_near;
+layout(std140) uniform chml_frame {
+    mat4 chml_view;
+    mat4 chml_projection;
+    mat4 chml_inverse_view_projection;
+    vec4 chml_viewport;
+    vec3 chml_origin;
+    float chml_near;
+};
 //uniform float FAR;
 
 float sdfSphere(in vec3 pos, in float radius) {
@@ -25,8 +25,15 @@ layout(location = 1) in vec4 vertex_normal;
 layout(location = 2) in vec2 vertex_uv;
   
 uniform mat4 chml_model;
-uniform mat4 chml_view;
-uniform mat4 chml_projection;
+
+layout(std140) uniform chml_frame {
+    mat4 chml_view;
+    mat4 chml_projection;
+    mat4 chml_inverse_view_projection;
+    vec4 chml_viewport;
+    vec3 chml_origin;
+    float chml_near;
+};
 
 out vec4 EC;
 out vec4 normal_EC;
@@ -22,7 +22,14 @@
 out vec3 color;
 
 uniform sampler2D tex;
-uniform vec4 chml_viewport;
+layout(std140) uniform chml_frame {
+    mat4 chml_view;
+    mat4 chml_projection;
+    mat4 chml_inverse_view_projection;
+    vec4 chml_viewport;
+    vec3 chml_origin;
+    float chml_near;
+};
 
 void main() {
      vec2 position = gl_FragCoord.xy / chml_viewport.zw;
@@ -29,5 +29,6 @@ int main(int argc, char** args) {
     InputController input;
     GraphicsContext context(input);
     SDFRenderer renderer(input);
+    context.get_shader_watcher().watch(renderer.get_program());
     context.start(renderer);
 }
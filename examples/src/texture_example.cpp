@@ -30,10 +30,9 @@ STATIC_INIT()
 int main(int argc, char** args) {
     InputController input;
     GraphicsContext context(input);
-    ImageData data = GLContext::get_image(
-                         GLContext::load_image("assets/tex_0.jpg"));
-    Texture texture("assets/tex_0.jpg",
-                    GL_RGBA32F,
+    Texture texture = context.get_texture_loader().load(
+                          "assets/tex_0.jpg",
+                          GL_RGBA32F,
     TextureParameterSet({
         WRAP_ST_CLAMP_TO_BORDER, FILTER_MIN_MAG_NEAREST
     }));
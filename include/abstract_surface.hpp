@@ -22,10 +22,18 @@
 
 #include <memory>
 
+// OpenGL / glew Headers
+#define GL3_PROTOTYPES 1
+#include <GL/glew.h>
+
 class AbstractSurface {
   public:
     virtual int get_width() const = 0;
     virtual int get_height() const = 0;
+    // Framebuffer object name, 0 for the default framebuffer
+    virtual GLuint get_framebuffer_id() const = 0;
+    // Color buffer that pixels are read back from
+    virtual GLenum get_read_buffer() const = 0;
     virtual void on_resize(const int& width, const int& height) = 0;
     virtual void bind() = 0;
     virtual void unbind() = 0;
@@ -0,0 +1,56 @@
+//
+// ChameleonGL - A small framework for OpenGL.
+// Copyright (C) 2012-2017 Srinivas Kaza
+//
+// This file is part of ChameleonGL.
+//
+// ChameleonGL is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ChameleonGL is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ChameleonGL.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#pragma once
+
+#include <atomic>
+#include <cstdlib>
+#include <cstddef>
+#include <new>
+
+// Counts every global operator new, but only in programs that opt in with
+// ALLOCATION_COUNTING_INIT() next to STATIC_INIT(). That replaces the global
+// operator new and delete, so it is left out of programs that replace them
+// themselves; without it the count stays at 0.
+#define ALLOCATION_STATS_INIT() \
+    std::atomic<size_t> AllocationStats::allocations(0);
+
+#define ALLOCATION_COUNTING_INIT() \
+    void* operator new(std::size_t size) { \
+        AllocationStats::allocations.fetch_add(1, \
+                                               std::memory_order_relaxed); \
+        void* ptr = std::malloc(size == 0 ? 1 : size); \
+        if (ptr == nullptr) \
+            throw std::bad_alloc(); \
+        return ptr; \
+    } \
+    void operator delete(void* ptr) noexcept { \
+        std::free(ptr); \
+    }
+
+class AllocationStats {
+  public:
+    static size_t count() {
+        return allocations.load(std::memory_order_relaxed);
+    }
+
+    static std::atomic<size_t> allocations;
+};
@@ -20,7 +20,16 @@
 
 #include "draw_command.hpp"
 #include "gl_context.hpp"
+#include "gl_state.hpp"
+#include "allocation_stats.hpp"
+#include "program_cache.hpp"
+#include "texture_loader.hpp"
 
 #define STATIC_INIT() \
     GL_STATIC_INIT() \
-    DRAW_STATIC_INIT()
+    GL_STATE_INIT() \
+    DRAW_STATIC_INIT() \
+    PROGRAM_STATIC_INIT() \
+    PROGRAM_CACHE_INIT() \
+    TEXTURE_LOADER_INIT() \
+    ALLOCATION_STATS_INIT()
@@ -41,6 +41,7 @@ class ClearCommand : public Command {
                  glm::vec4 clear_color = glm::vec4(0.0),
                  float depth_value = 1.0,
                  GLint stencil_value = 0) :
+        Command(COMMAND_CLEAR),
         _fbo(ptr),
         _buffers(buffers),
         _clear_color(clear_color),
@@ -63,7 +64,11 @@ class ClearCommand : public Command {
             clear_field |= GL_STENCIL_BUFFER_BIT;
         }
 
-        _fbo->bind();
+        if (_use_framebuffer) {
+            _fbo->bind();
+        } else {
+            GLState::bind_framebuffer(GL_FRAMEBUFFER, 0);
+        }
 
         // Ideally cache the results of previous clear color/depth/stencil
         // changes so that we don't have to issue all these calls!
@@ -74,8 +79,6 @@ class ClearCommand : public Command {
         glClearDepth(_depth_value);
         glClearStencil(_stencil_value);
         glClear(clear_field);
-
-        _fbo->unbind();
     }
 
     static void exec(ClearCommand& clearCommand) {
@@ -22,10 +22,44 @@
 
 #include <vector>
 #include <memory>
+#include <cstdint>
+
+class RenderState;
+
+// Commands tagged COMMAND_DRAW must be DrawCommands, which CommandBucket
+// and CommandExecutor cast them to
+enum CommandType : uint8_t {
+    COMMAND_DRAW,
+    COMMAND_CLEAR,
+    COMMAND_COMPUTE,
+    COMMAND_READBACK,
+    COMMAND_OTHER
+};
 
 class Command {
   public:
+    explicit Command(const CommandType& type = COMMAND_OTHER) :
+        _type(type) {
+
+    }
+
+    virtual ~Command() {
+
+    }
+
     virtual void operator()() = 0;
+
+    CommandType get_type() const {
+        return _type;
+    }
+
+    // The state this command must run under, or nullptr if it does not care
+    virtual const RenderState* get_render_state() const {
+        return nullptr;
+    }
+
+  private:
+    CommandType _type;
 };
 
 typedef std::shared_ptr<Command> CommandPtr;
@@ -0,0 +1,228 @@
+//
+// ChameleonGL - A small framework for OpenGL.
+// Copyright (C) 2012-2017 Srinivas Kaza
+//
+// This file is part of ChameleonGL.
+//
+// ChameleonGL is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ChameleonGL is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ChameleonGL.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#pragma once
+
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <memory>
+#include <cstdint>
+
+#include "command.hpp"
+#include "draw_command.hpp"
+#include "abstract_surface.hpp"
+
+// Reorders a CommandList so that draws sharing a framebuffer, program,
+// render state and texture set run back to back.
+//
+// Every DrawCommand gets a 64-bit key, from most to least significant:
+//
+//   [pass:8][target:6][program:12][render state:12][textures:10][depth:16]
+//
+// Any other command (clears, compute dispatches) is a barrier: it keeps its
+// position and draws are never moved across it. Draws with equal keys keep
+// their submission order. Targets are numbered in order of first use within
+// a run of draws, so a draw that samples a framebuffer rendered earlier in
+// the same run must be put in a later pass with DrawCommand::set_sort_hints.
+class CommandBucket {
+  public:
+    typedef std::pair<uint64_t, uint32_t> KeyIndex;
+
+    CommandBucket() :
+        _commands(),
+        _keys(),
+        _scratch(),
+        _targets() {
+
+    }
+
+    explicit CommandBucket(const CommandList& commands) : CommandBucket() {
+        add(commands);
+    }
+
+    void add(const CommandPtr& command) {
+        _commands.push_back(command);
+    }
+
+    void add(const CommandList& commands) {
+        _commands.insert(_commands.end(), commands.begin(), commands.end());
+    }
+
+    void clear() {
+        _commands.clear();
+    }
+
+    size_t size() const {
+        return _commands.size();
+    }
+
+    // Writes the sorted commands to `result`, reusing its capacity
+    void sort(CommandList& result) {
+        result.clear();
+        result.reserve(_commands.size());
+
+        size_t begin = 0;
+        for (size_t i = 0; i <= _commands.size(); i++) {
+            if (i == _commands.size() || !is_draw(_commands[i])) {
+                sort_segment(begin, i, result);
+                if (i < _commands.size()) {
+                    result.push_back(_commands[i]);
+                }
+                begin = i + 1;
+            }
+        }
+    }
+
+    CommandList sorted() {
+        CommandList result;
+        sort(result);
+        return result;
+    }
+
+    static uint64_t make_key(const uint8_t& pass,
+                             const uint64_t& target,
+                             const uint64_t& program,
+                             const uint64_t& render_state_hash,
+                             const uint64_t& texture_set_hash,
+                             const float& depth) {
+        float clamped = std::min(std::max(depth, 0.0f), 1.0f);
+        uint64_t depth_bits = (uint64_t)(clamped * DEPTH_MASK);
+
+        return ((uint64_t) pass << PASS_SHIFT) |
+               ((target & TARGET_MASK) << TARGET_SHIFT) |
+               ((program & PROGRAM_MASK) << PROGRAM_SHIFT) |
+               (fold(render_state_hash, STATE_BITS) << STATE_SHIFT) |
+               (fold(texture_set_hash, TEXTURE_BITS) << TEXTURE_SHIFT) |
+               depth_bits;
+    }
+
+    // Stable LSD radix sort on the 64-bit keys, one byte per pass. Passes in
+    // which every key has the same digit are skipped, so keys that only
+    // differ in a few fields cost a few passes.
+    static void radix_sort(std::vector<KeyIndex>& entries,
+                           std::vector<KeyIndex>& scratch) {
+        const size_t n = entries.size();
+        if (n < 2) {
+            return;
+        }
+
+        size_t counts[8][256] = {};
+        for (const KeyIndex& entry : entries) {
+            for (size_t digit = 0; digit < 8; digit++) {
+                counts[digit][(entry.first >> (8 * digit)) & 0xFF]++;
+            }
+        }
+
+        scratch.resize(n);
+        std::vector<KeyIndex>* src = &entries;
+        std::vector<KeyIndex>* dst = &scratch;
+        for (size_t digit = 0; digit < 8; digit++) {
+            const size_t shift = 8 * digit;
+            if (counts[digit][(entries[0].first >> shift) & 0xFF] == n) {
+                continue;
+            }
+
+            size_t offsets[256];
+            size_t sum = 0;
+            for (size_t bucket = 0; bucket < 256; bucket++) {
+                offsets[bucket] = sum;
+                sum += counts[digit][bucket];
+            }
+
+            for (const KeyIndex& entry : *src) {
+                (*dst)[offsets[(entry.first >> shift) & 0xFF]++] = entry;
+            }
+            std::swap(src, dst);
+        }
+
+        if (src != &entries) {
+            entries.swap(scratch);
+        }
+    }
+
+    constexpr static uint64_t DEPTH_MASK = 0xFFFF;
+    constexpr static uint64_t TEXTURE_BITS = 10;
+    constexpr static uint64_t TEXTURE_SHIFT = 16;
+    constexpr static uint64_t STATE_BITS = 12;
+    constexpr static uint64_t STATE_SHIFT = 26;
+    constexpr static uint64_t PROGRAM_MASK = 0xFFF;
+    constexpr static uint64_t PROGRAM_SHIFT = 38;
+    constexpr static uint64_t TARGET_MASK = 0x3F;
+    constexpr static uint64_t TARGET_SHIFT = 50;
+    constexpr static uint64_t PASS_SHIFT = 56;
+
+  private:
+    static bool is_draw(const CommandPtr& command) {
+        return command->get_type() == COMMAND_DRAW;
+    }
+
+    // XOR-folds a 64-bit hash down to its lowest `bits` bits
+    static uint64_t fold(uint64_t hash, const uint64_t bits) {
+        uint64_t folded = 0;
+        for (; hash != 0; hash >>= bits) {
+            folded ^= hash;
+        }
+        return folded & ((uint64_t(1) << bits) - 1);
+    }
+
+    uint64_t target_index(AbstractSurface* target) {
+        for (size_t i = 0; i < _targets.size(); i++) {
+            if (_targets[i] == target) {
+                return i;
+            }
+        }
+        _targets.push_back(target);
+        return _targets.size() - 1;
+    }
+
+    void sort_segment(const size_t& begin,
+                      const size_t& end,
+                      CommandList& out) {
+        _keys.clear();
+        _targets.clear();
+
+        for (size_t i = begin; i < end; i++) {
+            auto draw_command =
+                std::static_pointer_cast<DrawCommand>(_commands[i]);
+            uint64_t key = make_key(
+                               draw_command->get_pass(),
+                               target_index(
+                                   draw_command->get_framebuffer().get()),
+                               draw_command->get_program().id,
+                               draw_command->get_render_state()->hash(),
+                               draw_command->get_uniform_map().texture_set_hash(),
+                               draw_command->get_depth());
+            _keys.push_back(KeyIndex(key, (uint32_t) i));
+        }
+
+        radix_sort(_keys, _scratch);
+
+        for (const KeyIndex& entry : _keys) {
+            out.push_back(_commands[entry.second]);
+        }
+    }
+
+    CommandList _commands;
+    std::vector<KeyIndex> _keys;
+    std::vector<KeyIndex> _scratch;
+    std::vector<AbstractSurface*> _targets;
+};
@@ -0,0 +1,96 @@
+//
+// ChameleonGL - A small framework for OpenGL.
+// Copyright (C) 2012-2017 Srinivas Kaza
+//
+// This file is part of ChameleonGL.
+//
+// ChameleonGL is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ChameleonGL is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ChameleonGL.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#pragma once
+
+#include "command.hpp"
+#include "draw_command.hpp"
+#include "render_state.hpp"
+
+// Runs a CommandList, diffing the render state of consecutive commands so
+// that only the GL state that actually changes is touched. Within a list
+// the executor only keeps a pointer to the last state it applied, which
+// lives in that command; the state is copied once, when the list is done,
+// so the next list can be diffed against it.
+class CommandExecutor {
+  public:
+    CommandExecutor() :
+        _render_state(RenderState::default_state()),
+        _applied(&_render_state) {
+
+    }
+
+    CommandExecutor(const CommandExecutor& other) = delete;
+    CommandExecutor& operator=(const CommandExecutor& other) = delete;
+
+    void execute(const CommandList& commands) {
+        for (const CommandPtr& command : commands) {
+            run(*command);
+        }
+        finish();
+    }
+
+    void execute(Command& command) {
+        run(command);
+        finish();
+    }
+
+    const RenderState& get_render_state() const {
+        return *_applied;
+    }
+
+  private:
+    void run(Command& command) {
+        switch (command.get_type()) {
+        case COMMAND_DRAW: {
+            // Draws are the bulk of a frame, so they skip virtual dispatch
+            DrawCommand& draw = static_cast<DrawCommand&>(command);
+            apply(draw.DrawCommand::get_render_state());
+            draw.DrawCommand::operator()();
+            break;
+        }
+        default:
+            apply(command.get_render_state());
+            command();
+            break;
+        }
+    }
+
+    void apply(const RenderState* render_state) {
+        if (render_state == nullptr || render_state == _applied) {
+            return;
+        }
+        _applied->apply_diff(*render_state);
+        _applied = render_state;
+    }
+
+    // The last applied state belongs to a command that may not outlive the
+    // list, so it is kept by value from here on
+    void finish() {
+        if (_applied != &_render_state) {
+            _render_state = *_applied;
+            _applied = &_render_state;
+        }
+    }
+
+    RenderState _render_state;
+    const RenderState* _applied;
+};
@@ -29,6 +29,7 @@ class ComputeCommand : public Command {
     ComputeCommand(Program& program,
                    const glm::uvec3& workgroup_count,
                    UniformMap uniform_map = UniformMap()) :
+        Command(COMMAND_COMPUTE),
         _program(program),
         _workgroup_count(workgroup_count),
         _uniform_map(uniform_map) {
@@ -22,36 +22,47 @@
 
 #include <unordered_map>
 #include <functional>
+#include <mutex>
+#include <atomic>
+#include <stdexcept>
+#include <assert.h>
 
 #include "drawable.hpp"
 #include "abstract_surface.hpp"
 #include "command.hpp"
 #include "uniform_map.hpp"
+#include "uniform_block.hpp"
+#include "uniform_ring_buffer.hpp"
 #include "render_state.hpp"
 #include "opengl_utils.hpp"
 
 #define DRAW_STATIC_INIT() \
-    std::vector<std::reference_wrapper<Program>> DrawCommand::_programs;
+    UniformMap DrawCommand::_globals; \
+    std::mutex DrawCommand::_globals_mutex; \
+    std::atomic<uint64_t> DrawCommand::_globals_version(0); \
+    FrameUniformBlock DrawCommand::_frame_block;
 
 class DrawCommand : public Command {
   public:
+    // Draws may be recorded on ParallelRecorder workers, which have no GL
+    // context, so nothing here may call GL. Programs bind the chml_frame
+    // block themselves when they link (Program::on_link).
     DrawCommand(Drawable& drawable,
                 Program& program,
                 AbstractSurfacePtr framebuffer,
                 UniformMap uniform_map = UniformMap(),
                 RenderState render_state = RenderState()) :
+        Command(COMMAND_DRAW),
         _drawable(drawable),
         _program(program),
         _framebuffer(framebuffer),
         _uniform_map(uniform_map),
         _render_state(render_state),
-        _use_framebuffer(framebuffer->get_width() > 0) {
-        for (Program& program : _programs) {
-            if (program == _program)
-                return;
-        }
+        _use_framebuffer(framebuffer->get_width() > 0),
+        _num_blocks(0),
+        _pass(0),
+        _depth(0.0f) {
 
-        _programs.push_back(std::ref(program));
     }
 
     void operator()() override {
@@ -59,29 +70,104 @@ class DrawCommand : public Command {
         _drawable.on_draw();
         VAO vao = _drawable.get_vao();
 
+        // Surfaces without a size stand for the default framebuffer
         if (_use_framebuffer) {
             _framebuffer->bind();
+        } else {
+            GLState::bind_framebuffer(GL_FRAMEBUFFER, 0);
         }
 
+        apply_globals(_program);
         _uniform_map.apply(_program);
+        for (size_t i = 0; i < _num_blocks; i++) {
+            UniformRingBuffer::bind(_blocks[i].range, _blocks[i].binding);
+        }
         vao.draw();
         _uniform_map.post_render();
+    }
 
-        if (_use_framebuffer) {
-            _framebuffer->unbind();
+    const RenderState* get_render_state() const override {
+        return &(this->_render_state);
+    }
+
+    const Program& get_program() const {
+        return this->_program;
+    }
+
+    const AbstractSurfacePtr& get_framebuffer() const {
+        return this->_framebuffer;
+    }
+
+    const UniformMap& get_uniform_map() const {
+        return this->_uniform_map;
+    }
+
+    // Binds `range` (usually allocated from the frame's UniformRingBuffer)
+    // to `binding` for this draw. Binding FRAME_BLOCK_BINDING is reserved.
+    void set_uniform_block(const GLuint& binding,
+                           const UniformBufferRange& range) {
+        assert(binding != FRAME_BLOCK_BINDING);
+        for (size_t i = 0; i < _num_blocks; i++) {
+            if (_blocks[i].binding == binding) {
+                _blocks[i].range = range;
+                return;
+            }
+        }
+        if (_num_blocks == MAX_UNIFORM_BLOCKS) {
+            throw std::runtime_error("Too many uniform blocks on one draw");
         }
+        _blocks[_num_blocks++] = BoundBlock({binding, range});
+    }
+
+    // Sorting hints used by CommandBucket. Draws in a lower pass always run
+    // before draws in a higher pass; depth is a normalized [0, 1] view depth
+    // used to order draws front-to-back once everything else is equal.
+    void set_sort_hints(const uint8_t& pass, const float& depth = 0.0f) {
+        this->_pass = pass;
+        this->_depth = depth;
     }
 
-    RenderState get_render_state() {
-        return this->_render_state;
+    uint8_t get_pass() const {
+        return this->_pass;
     }
 
+    float get_depth() const {
+        return this->_depth;
+    }
+
+    // Sets a uniform on every program that is drawn. The value goes into a
+    // global table which is applied to a program the next time it is drawn
+    // after the table changed, so the cost of a broadcast does not depend
+    // on how many programs exist. Programs without the uniform ignore it.
+    // Textures belong in a draw's UniformMap instead.
     template <typename T>
-    static void set_uniform(const std::string& name,
+    static void set_uniform(const UniformName& name,
                             T value) {
-        for (Program& program : _programs) {
-            program.set_uniform(name, value, false);
-        }
+        std::lock_guard<std::mutex> lock(_globals_mutex);
+        _globals.set(name, value);
+        _globals_version++;
+    }
+
+    // Camera values for the chml_frame block, which GraphicsContext uploads
+    // once per frame
+    static void set_frame_camera(const glm::mat4& view,
+                                 const glm::mat4& projection,
+                                 const glm::vec3& origin,
+                                 const float& near) {
+        _frame_block.chml_view = view;
+        _frame_block.chml_projection = projection;
+        _frame_block.chml_inverse_view_projection =
+            glm::inverse(projection * view);
+        _frame_block.chml_origin = origin;
+        _frame_block.chml_near = near;
+    }
+
+    static void set_frame_viewport(const glm::vec4& viewport) {
+        _frame_block.chml_viewport = viewport;
+    }
+
+    static const FrameUniformBlock& get_frame_block() {
+        return _frame_block;
     }
 
     static void exec(DrawCommand& drawCommand) {
@@ -89,6 +175,23 @@ class DrawCommand : public Command {
     }
 
   private:
+    static void apply_globals(Program& program) {
+        if (program.get_globals_version() == _globals_version.load()) {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(_globals_mutex);
+        _globals.apply(program, false);
+        program.set_globals_version(_globals_version.load());
+    }
+
+    constexpr static size_t MAX_UNIFORM_BLOCKS = 4;
+
+    typedef struct {
+        GLuint binding;
+        UniformBufferRange range;
+    } BoundBlock;
+
     Drawable& _drawable;
     Program& _program;
     AbstractSurfacePtr _framebuffer;
@@ -97,5 +200,14 @@ class DrawCommand : public Command {
 
     bool _use_framebuffer;
 
-    static std::vector<std::reference_wrapper<Program>> _programs;
+    BoundBlock _blocks[MAX_UNIFORM_BLOCKS];
+    size_t _num_blocks;
+
+    uint8_t _pass;
+    float _depth;
+
+    static UniformMap _globals;
+    static std::mutex _globals_mutex;
+    static std::atomic<uint64_t> _globals_version;
+    static FrameUniformBlock _frame_block;
 };
@@ -21,6 +21,7 @@
 #pragma once
 
 #include "abstract_surface.hpp"
+#include "gl_state.hpp"
 
 class DummyFramebuffer : public AbstractSurface {
   public:
@@ -44,17 +45,29 @@ class DummyFramebuffer : public AbstractSurface {
         return _height;
     }
 
+    virtual GLuint get_framebuffer_id() const {
+        return 0;
+    }
+
+    virtual GLenum get_read_buffer() const {
+        return GL_BACK;
+    }
+
     virtual void on_resize(const int& width, const int& height) {
         _width = width;
         _height = height;
     }
 
+    // Stands for the default framebuffer
     virtual void bind() {
-        // Does absolutely nothing
+        GLState::bind_framebuffer(GL_FRAMEBUFFER, 0);
+        if (_width > 0 && _height > 0) {
+            GLState::viewport(0, 0, _width, _height);
+        }
     }
 
     virtual void unbind() {
-        // Also does absolutely nothing
+        // Does absolutely nothing
     }
   private:
     int _width;
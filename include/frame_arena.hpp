@@ -0,0 +1,203 @@
+//
+// ChameleonGL - A small framework for OpenGL.
+// Copyright (C) 2012-2017 Srinivas Kaza
+//
+// This file is part of ChameleonGL.
+//
+// ChameleonGL is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ChameleonGL is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ChameleonGL.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+#include <assert.h>
+
+// A per-frame linear allocator. Allocations bump a pointer through a list of
+// blocks that are kept between frames, so once the arena has grown to fit a
+// frame, later frames allocate nothing from the heap. Individual frees only
+// update the live counts; memory is reclaimed all at once by reset().
+//
+// A block that still holds a live allocation at reset() (say, a command
+// whose shared_ptr a renderer kept) is not reused until a later reset()
+// finds it empty, so held objects are never overwritten.
+class FrameArena {
+  public:
+    explicit FrameArena(const size_t& block_size = DEFAULT_BLOCK_SIZE) :
+        _blocks(),
+        _block_size(block_size),
+        _current(0),
+        _offset(0),
+        _bytes_used(0),
+        _live(0) {
+
+    }
+
+    FrameArena(const FrameArena& other) = delete;
+    FrameArena& operator=(const FrameArena& other) = delete;
+
+    void* allocate(const size_t& num_bytes, const size_t& alignment) {
+        while (_current < _blocks.size()) {
+            Block& block = _blocks[_current];
+            if (block.pinned) {
+                _current++;
+                _offset = 0;
+                continue;
+            }
+            uintptr_t base = (uintptr_t) block.data.get();
+            uintptr_t aligned = (base + _offset + alignment - 1) &
+                                ~(uintptr_t)(alignment - 1);
+            if (aligned + num_bytes <= base + block.size) {
+                _bytes_used += (aligned + num_bytes) - (base + _offset);
+                _offset = (aligned + num_bytes) - base;
+                block.live++;
+                _live++;
+                return (void*) aligned;
+            }
+            _current++;
+            _offset = 0;
+        }
+
+        size_t size = std::max(_block_size, num_bytes + alignment);
+        Block block;
+        block.data.reset(new uint8_t[size]);
+        block.size = size;
+        block.live = 0;
+        block.pinned = false;
+        _blocks.push_back(std::move(block));
+        return allocate(num_bytes, alignment);
+    }
+
+    void deallocate(void* ptr) {
+        uintptr_t address = (uintptr_t) ptr;
+        for (Block& block : _blocks) {
+            uintptr_t base = (uintptr_t) block.data.get();
+            if (address >= base && address < base + block.size) {
+                assert(block.live > 0);
+                block.live--;
+                break;
+            }
+        }
+        assert(_live > 0);
+        _live--;
+    }
+
+    // Makes every block without live allocations available again
+    void reset() {
+        for (Block& block : _blocks) {
+            block.pinned = (block.live > 0);
+        }
+        _current = 0;
+        _offset = 0;
+        _bytes_used = 0;
+    }
+
+    size_t bytes_used() const {
+        return _bytes_used;
+    }
+
+    size_t capacity() const {
+        size_t total = 0;
+        for (const Block& block : _blocks) {
+            total += block.size;
+        }
+        return total;
+    }
+
+    size_t live_allocations() const {
+        return _live;
+    }
+
+    // Blocks kept out of reuse because they held live allocations at the
+    // last reset()
+    size_t pinned_blocks() const {
+        size_t count = 0;
+        for (const Block& block : _blocks) {
+            if (block.pinned) {
+                count++;
+            }
+        }
+        return count;
+    }
+
+    template <typename T, typename... Args>
+    std::shared_ptr<T> make_shared(Args&& ... args);
+
+    constexpr static size_t DEFAULT_BLOCK_SIZE = 1 << 16;
+
+  private:
+    typedef struct {
+        std::unique_ptr<uint8_t[]> data;
+        size_t size;
+        size_t live;
+        bool pinned;
+    } Block;
+
+    std::vector<Block> _blocks;
+    size_t _block_size;
+    size_t _current;
+    size_t _offset;
+    size_t _bytes_used;
+    size_t _live;
+};
+
+// Standard allocator adapter, so that std::allocate_shared can place both a
+// command and its control block in a FrameArena
+template <typename T>
+class ArenaAllocator {
+  public:
+    typedef T value_type;
+
+    explicit ArenaAllocator(FrameArena& arena) :
+        arena(&arena) {
+
+    }
+
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) :
+        arena(other.arena) {
+
+    }
+
+    T* allocate(const size_t& n) {
+        return (T*) arena->allocate(n * sizeof(T), alignof(T));
+    }
+
+    void deallocate(T* ptr, const size_t& n) {
+        arena->deallocate(ptr);
+    }
+
+    template <typename U>
+    bool operator==(const ArenaAllocator<U>& other) const {
+        return arena == other.arena;
+    }
+
+    template <typename U>
+    bool operator!=(const ArenaAllocator<U>& other) const {
+        return arena != other.arena;
+    }
+
+    FrameArena* arena;
+};
+
+template <typename T, typename... Args>
+std::shared_ptr<T> FrameArena::make_shared(Args&& ... args) {
+    return std::allocate_shared<T>(ArenaAllocator<T>(*this),
+                                   std::forward<Args>(args)...);
+}
@@ -0,0 +1,83 @@
+//
+// ChameleonGL - A small framework for OpenGL.
+// Copyright (C) 2012-2017 Srinivas Kaza
+//
+// This file is part of ChameleonGL.
+//
+// ChameleonGL is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ChameleonGL is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ChameleonGL.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#pragma once
+
+#include <utility>
+#include <memory>
+
+#include "command.hpp"
+#include "frame_arena.hpp"
+
+// A CommandList whose commands are constructed in a FrameArena. The list
+// keeps its capacity across clear(), so recording a frame of the same shape
+// as the last one performs no heap allocations. Without an arena, commands
+// fall back to std::make_shared.
+class FrameCommandList {
+  public:
+    FrameCommandList() :
+        _arena(nullptr),
+        _commands() {
+
+    }
+
+    explicit FrameCommandList(FrameArena& arena) :
+        _arena(&arena),
+        _commands() {
+
+    }
+
+    template <typename T, typename... Args>
+    std::shared_ptr<T> emplace(Args&& ... args) {
+        std::shared_ptr<T> command;
+        if (_arena != nullptr) {
+            command = _arena->make_shared<T>(std::forward<Args>(args)...);
+        } else {
+            command = std::make_shared<T>(std::forward<Args>(args)...);
+        }
+        _commands.push_back(command);
+        return command;
+    }
+
+    void push_back(const CommandPtr& command) {
+        _commands.push_back(command);
+    }
+
+    void append(const CommandList& commands) {
+        _commands.insert(_commands.end(), commands.begin(), commands.end());
+    }
+
+    void clear() {
+        _commands.clear();
+    }
+
+    size_t size() const {
+        return _commands.size();
+    }
+
+    const CommandList& commands() const {
+        return _commands;
+    }
+
+  private:
+    FrameArena* _arena;
+    CommandList _commands;
+};
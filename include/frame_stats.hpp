@@ -0,0 +1,39 @@
+//
+// ChameleonGL - A small framework for OpenGL.
+// Copyright (C) 2012-2017 Srinivas Kaza
+//
+// This file is part of ChameleonGL.
+//
+// ChameleonGL is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ChameleonGL is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ChameleonGL.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#pragma once
+
+#include <cstddef>
+
+typedef struct {
+    // Heap allocations made by any thread during the frame. Only counted in
+    // programs using ALLOCATION_COUNTING_INIT().
+    size_t heap_allocations = 0;
+    // Bytes of the frame arena used by the frame's commands
+    size_t arena_bytes = 0;
+    // Binds skipped because GLState showed them to be redundant
+    size_t elided_binds = 0;
+    // Images TextureLoader uploaded at the start of the frame
+    size_t textures_uploaded = 0;
+    // Bytes of texture updates TextureStreamer issued at the start of the
+    // frame
+    size_t streamed_bytes = 0;
+} FrameStats;
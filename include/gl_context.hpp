@@ -24,14 +24,16 @@
 #define GL3_PROTOTYPES 1
 #include <GL/glew.h>
 
-#include <unordered_set>
+#include <string>
 #include <assert.h>
 
 #include "image_data.hpp"
+#include "gl_state.hpp"
 
 #define GL_STATIC_INIT() \
-    std::unordered_set<int> GLContext::texture_image_units; \
+    GLint GLContext::next_texture_image_unit = 0; \
     GLint GLContext::max_texture_image_units;               \
+    bool GLContext::parallel_shader_compile = false; \
     ImagePool GLContext::image_pool; \
     const GLfloat GLContext::quad_vertex_buffer_data[18] = { \
         -1.0f, -1.0f, 0.0f, \
@@ -39,23 +41,21 @@
         -1.0f,  1.0f, 0.0f, \
         -1.0f,  1.0f, 0.0f, \
         1.0f, -1.0f, 0.0f, \
-        1.0f,  1.0f, 0.0f}; \
-    std::unordered_set<GLuint> GLContext::bound_buffers;
+        1.0f,  1.0f, 0.0f};
 
 class GLContext {
   public:
+    // Units are handed out in order and only given back all at once, so a
+    // counter is enough to track them and a draw allocates nothing
     static GLenum get_texturing_unit() {
-        for (int i = 0; i < GLContext::max_texture_image_units; i++) {
-            if (texture_image_units.find(i) == texture_image_units.end()) {
-                texture_image_units.insert(i);
-                return i;
-            }
+        if (next_texture_image_unit < max_texture_image_units) {
+            return next_texture_image_unit++;
         }
         return -1;
     }
 
     static void clear_texturing_unit() {
-        GLContext::texture_image_units.clear();
+        GLContext::next_texture_image_unit = 0;
     }
 
     static int load_image(std::string filename) {
@@ -70,42 +70,69 @@ class GLContext {
         image_pool.remove(index);
     }
 
-    static bool add_bound_buffer(const GLuint& buffer) {
-        if (bound_buffers.count(buffer) != 0) {
-            return false;
-        } else {
-            bound_buffers.insert(buffer);
-            return true;
+    static void gl_init() {
+        glGetIntegerv(GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS,
+                      &max_texture_image_units);
+        assert(GLEW_ARB_direct_state_access);
+        // Whatever SDL did while creating the context is unknown
+        GLState::invalidate();
+        bool khr = glewIsSupported("GL_KHR_parallel_shader_compile");
+        bool arb = glewIsSupported("GL_ARB_parallel_shader_compile");
+        parallel_shader_compile = khr || arb;
+
+        // 0xFFFFFFFF lets the driver pick how many compiler threads to use.
+        // GLEW releases before 2.1 do not declare these entry points.
+#ifdef GL_KHR_parallel_shader_compile
+        if (khr) {
+            glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
         }
+#endif
+#ifdef GL_ARB_parallel_shader_compile
+        if (arb && !khr) {
+            glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+        }
+#endif
     }
 
-    static bool is_buffer_bound(const GLuint& buffer) {
-        return bound_buffers.count(buffer) == 1;
-    }
-
-    static bool remove_bound_buffer(const GLuint& buffer) {
-        if (bound_buffers.count(buffer) == 0) {
+    // Parses a "major.minor" version like "4.3", returning false if
+    // `version` is anything else
+    static bool parse_version(const std::string& version,
+                              int& major,
+                              int& minor) {
+        size_t dot = version.find('.');
+        if (dot == std::string::npos || dot == 0 ||
+                dot + 1 == version.size() || dot > 2 ||
+                version.size() - dot - 1 > 2) {
             return false;
-        } else {
-            bound_buffers.erase(buffer);
-            return true;
         }
-    }
 
-    static void gl_init() {
-        glGetIntegerv(GL_MAX_COMBINED_TEXTURE_IMAGE_UNITS,
-                      &max_texture_image_units);
-        assert(GLEW_ARB_direct_state_access);
+        int parts[2] = {0, 0};
+        for (size_t i = 0; i < version.size(); i++) {
+            if (i == dot) {
+                continue;
+            }
+            if (version[i] < '0' || version[i] > '9') {
+                return false;
+            }
+            int& part = parts[i < dot ? 0 : 1];
+            part = part * 10 + (version[i] - '0');
+        }
+
+        major = parts[0];
+        minor = parts[1];
+        return true;
     }
 
     static void gl_refresh() {
         clear_texturing_unit();
     }
 
-    static std::unordered_set<int> texture_image_units;
+    // The lowest texture unit not handed out since the last clear
+    static GLint next_texture_image_unit;
     static GLint max_texture_image_units;
+    // Whether GL_COMPLETION_STATUS_KHR can be queried
+    static bool parallel_shader_compile;
     static ImagePool image_pool;
-    static std::unordered_set<GLuint> bound_buffers;
 
 
     const static GLfloat quad_vertex_buffer_data[18];
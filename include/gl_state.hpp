@@ -0,0 +1,286 @@
+//
+// ChameleonGL - A small framework for OpenGL.
+// Copyright (C) 2012-2017 Srinivas Kaza
+//
+// This file is part of ChameleonGL.
+//
+// ChameleonGL is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ChameleonGL is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ChameleonGL.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#pragma once
+
+#include <vector>
+#include <initializer_list>
+#include <cstddef>
+
+// OpenGL / glew Headers
+#define GL3_PROTOTYPES 1
+#include <GL/glew.h>
+
+#define GL_STATE_INIT() \
+    constexpr GLuint GLState::UNKNOWN; \
+    constexpr GLsizeiptr GLState::WHOLE_BUFFER; \
+    GLState::State GLState::state;
+
+// A shadow copy of the GL bindings that the framework changes: the current
+// program, vertex array, draw and read framebuffers, the active texture
+// unit and the texture bound to each unit, indexed uniform and shader
+// storage buffer bindings, non-indexed buffer bindings and the viewport. A
+// bind that matches the shadow copy is skipped, so nothing has to be
+// unbound after use.
+//
+// Every bind must go through here for the shadow copy to stay correct. Code
+// that calls GL directly has to invalidate() afterwards.
+class GLState {
+  public:
+    static void use_program(const GLuint& program) {
+        if (changed(state.program, program)) {
+            glUseProgram(program);
+        }
+    }
+
+    static void bind_vertex_array(const GLuint& vao) {
+        if (changed(state.vertex_array, vao)) {
+            state.element_array_buffer = UNKNOWN;
+            glBindVertexArray(vao);
+        }
+    }
+
+    // GL_FRAMEBUFFER binds both the draw and read framebuffer
+    static void bind_framebuffer(const GLenum& target, const GLuint& fbo) {
+        bool draw = target != GL_READ_FRAMEBUFFER;
+        bool read = target != GL_DRAW_FRAMEBUFFER;
+        if ((!draw || state.draw_framebuffer == fbo) &&
+                (!read || state.read_framebuffer == fbo)) {
+            state.elided++;
+            return;
+        }
+
+        if (draw) {
+            state.draw_framebuffer = fbo;
+        }
+        if (read) {
+            state.read_framebuffer = fbo;
+        }
+        glBindFramebuffer(target, fbo);
+    }
+
+    static void bind_texture_unit(const GLuint& unit, const GLuint& texture) {
+        if (unit >= state.texture_units.size()) {
+            state.texture_units.resize(unit + 1, UNKNOWN);
+        }
+        if (changed(state.texture_units[unit], texture)) {
+            glBindTextureUnit(unit, texture);
+        }
+    }
+
+    // Selects the unit that non-DSA texture calls act on
+    static void active_texture(const GLuint& unit) {
+        if (changed(state.active_texture, unit)) {
+            glActiveTexture(GL_TEXTURE0 + unit);
+        }
+    }
+
+    // Binds `texture` to `unit` and makes that unit the active one
+    static void bind_active_texture(const GLuint& unit,
+                                    const GLuint& texture) {
+        active_texture(unit);
+        bind_texture_unit(unit, texture);
+    }
+
+    static void bind_buffer(const GLenum& target, const GLuint& buffer) {
+        GLuint* binding = buffer_binding(target);
+        if (binding == nullptr || changed(*binding, buffer)) {
+            glBindBuffer(target, buffer);
+        }
+    }
+
+    // Unbinds `buffer` from `target` only if it is the one bound there
+    static void unbind_buffer(const GLenum& target, const GLuint& buffer) {
+        GLuint* binding = buffer_binding(target);
+        if (binding != nullptr && *binding == buffer) {
+            *binding = 0;
+            glBindBuffer(target, 0);
+        }
+    }
+
+    static void bind_buffer_base(const GLenum& target,
+                                 const GLuint& index,
+                                 const GLuint& buffer) {
+        bind_buffer_range(target, index, buffer, 0, WHOLE_BUFFER);
+    }
+
+    // A size of WHOLE_BUFFER binds the whole buffer with glBindBufferBase
+    static void bind_buffer_range(const GLenum& target,
+                                  const GLuint& index,
+                                  const GLuint& buffer,
+                                  const GLintptr& offset,
+                                  const GLsizeiptr& size) {
+        std::vector<BufferRange>* bindings = indexed_bindings(target);
+        if (bindings != nullptr) {
+            if (index >= bindings->size()) {
+                bindings->resize(index + 1,
+                                 BufferRange({UNKNOWN, 0, WHOLE_BUFFER}));
+            }
+            BufferRange& binding = (*bindings)[index];
+            if (binding.buffer == buffer && binding.offset == offset &&
+                    binding.size == size) {
+                state.elided++;
+                return;
+            }
+            binding = BufferRange({buffer, offset, size});
+        }
+
+        // Indexed binds also replace the generic binding point
+        GLuint* generic = buffer_binding(target);
+        if (generic != nullptr) {
+            *generic = buffer;
+        }
+
+        if (size == WHOLE_BUFFER) {
+            glBindBufferBase(target, index, buffer);
+        } else {
+            glBindBufferRange(target, index, buffer, offset, size);
+        }
+    }
+
+    static void viewport(const GLint& x,
+                         const GLint& y,
+                         const GLsizei& width,
+                         const GLsizei& height) {
+        if (state.viewport[0] == x && state.viewport[1] == y &&
+                state.viewport[2] == width && state.viewport[3] == height) {
+            state.elided++;
+            return;
+        }
+
+        state.viewport[0] = x;
+        state.viewport[1] = y;
+        state.viewport[2] = width;
+        state.viewport[3] = height;
+        glViewport(x, y, width, height);
+    }
+
+    // Deleting a buffer unbinds it everywhere, and its name may be reused
+    static void forget_buffer(const GLuint& buffer) {
+        for (GLuint* binding : {
+                    &state.array_buffer, &state.element_array_buffer,
+                    &state.uniform_buffer, &state.shader_storage_buffer,
+                    &state.pixel_pack_buffer, &state.pixel_unpack_buffer
+                }) {
+            if (*binding == buffer) {
+                *binding = 0;
+            }
+        }
+        for (std::vector<BufferRange>* bindings : {
+                    &state.uniform_buffers, &state.shader_storage_buffers
+                }) {
+            for (BufferRange& binding : *bindings) {
+                if (binding.buffer == buffer) {
+                    binding.buffer = 0;
+                }
+            }
+        }
+    }
+
+    // Forgets everything, so that the next bind of each kind is issued
+    static void invalidate() {
+        size_t elided = state.elided;
+        state = State();
+        state.elided = elided;
+    }
+
+    // Binds skipped since the last reset_counters()
+    static size_t elided_count() {
+        return state.elided;
+    }
+
+    static void reset_counters() {
+        state.elided = 0;
+    }
+
+    constexpr static GLuint UNKNOWN = ~0u;
+    constexpr static GLsizeiptr WHOLE_BUFFER = -1;
+
+  private:
+    typedef struct {
+        GLuint buffer;
+        GLintptr offset;
+        GLsizeiptr size;
+    } BufferRange;
+
+    struct State {
+        GLuint program = UNKNOWN;
+        GLuint vertex_array = UNKNOWN;
+        GLuint draw_framebuffer = UNKNOWN;
+        GLuint read_framebuffer = UNKNOWN;
+        GLint viewport[4] = {-1, -1, -1, -1};
+        GLuint active_texture = UNKNOWN;
+        std::vector<GLuint> texture_units;
+
+        // Part of the vertex array state, so forgotten whenever it changes
+        GLuint element_array_buffer = UNKNOWN;
+        GLuint array_buffer = UNKNOWN;
+        GLuint uniform_buffer = UNKNOWN;
+        GLuint shader_storage_buffer = UNKNOWN;
+        GLuint pixel_pack_buffer = UNKNOWN;
+        GLuint pixel_unpack_buffer = UNKNOWN;
+        std::vector<BufferRange> uniform_buffers;
+        std::vector<BufferRange> shader_storage_buffers;
+
+        size_t elided = 0;
+    };
+
+    static bool changed(GLuint& current, const GLuint& value) {
+        if (current == value) {
+            state.elided++;
+            return false;
+        }
+        current = value;
+        return true;
+    }
+
+    static GLuint* buffer_binding(const GLenum& target) {
+        switch (target) {
+            case GL_ARRAY_BUFFER:
+                return &state.array_buffer;
+            case GL_ELEMENT_ARRAY_BUFFER:
+                return &state.element_array_buffer;
+            case GL_UNIFORM_BUFFER:
+                return &state.uniform_buffer;
+            case GL_SHADER_STORAGE_BUFFER:
+                return &state.shader_storage_buffer;
+            case GL_PIXEL_PACK_BUFFER:
+                return &state.pixel_pack_buffer;
+            case GL_PIXEL_UNPACK_BUFFER:
+                return &state.pixel_unpack_buffer;
+            default:
+                return nullptr;
+        }
+    }
+
+    static std::vector<BufferRange>* indexed_bindings(const GLenum& target) {
+        switch (target) {
+            case GL_UNIFORM_BUFFER:
+                return &state.uniform_buffers;
+            case GL_SHADER_STORAGE_BUFFER:
+                return &state.shader_storage_buffers;
+            default:
+                return nullptr;
+        }
+    }
+
+    static State state;
+};
@@ -25,6 +25,7 @@
 #include <unordered_map>
 #include <memory>
 #include <vector>
+#include <atomic>
 #include <assert.h>
 
 // OpenGL / glew Headers
@@ -37,41 +38,91 @@
 #include "event_handler.hpp"
 #include "sdl_helpers.hpp"
 #include "gl_context.hpp"
+#include "headless_context.hpp"
+#include "opengl_utils.hpp"
 #include "render_state.hpp"
 #include "command.hpp"
 #include "draw_command.hpp"
+#include "command_bucket.hpp"
+#include "command_executor.hpp"
 #include "dummy_framebuffer.hpp"
 #include "renderer.hpp"
+#include "frame_arena.hpp"
+#include "frame_command_list.hpp"
+#include "frame_stats.hpp"
+#include "allocation_stats.hpp"
+#include "uniform_block.hpp"
+#include "uniform_ring_buffer.hpp"
+#include "program_cache.hpp"
+#include "shader_watcher.hpp"
+#include "texture_loader.hpp"
+#include "texture_streamer.hpp"
+#include "readback_queue.hpp"
+#include "readback_command.hpp"
 
 class GraphicsContext {
   public:
     GraphicsContext(EventHandler& ev_handler,
                     const std::unordered_map<std::string, void*>& options) :
         handler(ev_handler),
-        render_state() {
-        SDL_Init(SDL_INIT_EVERYTHING);
-        IMG_Init(IMG_INIT_JPG | IMG_INIT_PNG);
-
+        executor(),
+        arena(),
+        frame_commands(arena),
+        default_surface(),
+        uniform_buffer(),
+        shader_watcher(),
+        texture_loader(),
+        // Megabytes of memory for streaming texture updates, which is only
+        // mapped once something is streamed
+        texture_streamer((size_t) default_value("texture_stream_mb", 64,
+                                                options) << 20),
+        readback_queue(),
+        frame_stats(),
+        headless_context(),
+        frames_rendered(0),
+        stop_requested(false) {
+        this->wp.window = NULL;
+        this->wp.gl_context = NULL;
         this->wp.width = default_value("width", WIDTH, options);
         this->wp.height = default_value("height", HEIGHT, options);
-        this->wp.window =
-            SDL_CreateWindow("SDF Renderer", SDL_WINDOWPOS_UNDEFINED,
-                             SDL_WINDOWPOS_UNDEFINED,
-                             this->wp.width,
-                             this->wp.height,
-                             SDL_WINDOW_OPENGL | SDL_WINDOW_SHOWN);
+        this->sort_commands = default_value("sort_commands", false, options);
 
+        // Renders into a framebuffer object, without a window or a display.
+        // Headless runs stop after `frames` frames, or run until stop() if
+        // that is 0.
+        this->headless = default_value("headless", false, options);
+        this->max_frames = default_value("frames", 0, options);
 
-        set_gl_attributes(default_value("opengl_version", "4.3", options));
-        this->wp.gl_context = SDL_GL_CreateContext(this->wp.window);
-        if (this->wp.gl_context == NULL) {
-            DEBUG("OpenGL context could not be created!");
+        SDL_Init(headless ? SDL_INIT_EVENTS : SDL_INIT_EVERYTHING);
+        IMG_Init(IMG_INIT_JPG | IMG_INIT_PNG);
+
+        // Directory to keep linked program binaries in across runs
+        std::string program_cache =
+            default_value("program_cache", std::string(), options);
+        if (!program_cache.empty()) {
+            ProgramCache::enable(program_cache);
+        }
+
+        std::string version =
+            default_value("opengl_version", std::string("4.3"), options);
+        int major = 0;
+        int minor = 0;
+        if (!GLContext::parse_version(version, major, minor)) {
+            ERROR("OpenGL version " << version <<
+                  " is not of the form major.minor!");
             exit(1);
         }
-        SDL_GL_MakeCurrent(this->wp.window, this->wp.gl_context);
+        if (headless) {
+            create_headless_context(major, minor);
+        } else {
+            create_window(major, minor);
+        }
 
+        // Without an X display GLEW still loads the GL entry points, but
+        // fails on the GLX ones, which a headless context does not need
         GLenum err = glewInit();
-        if (err != GLEW_OK) {
+        if (err != GLEW_OK &&
+                !(headless && err == GLEW_ERROR_NO_GLX_DISPLAY)) {
             ERROR("GLEW could not be initialized!");
             exit(1);
         }
@@ -81,14 +132,16 @@ class GraphicsContext {
             exit(1);
         }
 
-        SDL_GL_SetSwapInterval(1);
-
-        this->wp.renderer = SDL_CreateRenderer(this->wp.window, -1, 0);
-        this->render_texture =
-            SDL_CreateTexture(
-                this->wp.renderer, SDL_PIXELFORMAT_RGB888,
-                SDL_TEXTUREACCESS_STREAMING, WIDTH, HEIGHT);
         GLContext::gl_init();
+        if (headless) {
+            default_surface = Framebuffer::cast_up(
+                                  std::make_shared<Framebuffer>(
+                                      this->wp.width, this->wp.height, true,
+                                      GL_RGBA, GL_RGBA8, GL_UNSIGNED_BYTE));
+        } else {
+            default_surface = std::make_shared<DummyFramebuffer>(
+                                  this->wp.width, this->wp.height);
+        }
     }
 
     GraphicsContext(EventHandler& ev_handler) :
@@ -100,68 +153,173 @@ class GraphicsContext {
         for (long accum = 0; accum >= 0;) {
             long dt = mainloop(renderer);
             if (dt == -1)
-                return;
+                break;
             accum += dt;
         }
+
+        // Resolves readbacks of the last frames, which a batch render
+        // would otherwise lose
+        glFinish();
+        readback_queue.poll();
+    }
+
+    // Ends start() after the current frame. May be called from any thread.
+    void stop() {
+        stop_requested.store(true);
+    }
+
+    bool is_headless() const {
+        return headless;
+    }
+
+    // Per-frame uniform blocks for draws recorded this frame are allocated
+    // from here, and are only valid until the frame has been executed
+    UniformRingBuffer& get_uniform_buffer() {
+        return uniform_buffer;
+    }
+
+    // Programs watched here are rebuilt at the start of the frame after one
+    // of their shader files changes
+    ShaderWatcher& get_shader_watcher() {
+        return shader_watcher;
+    }
+
+    TextureLoader& get_texture_loader() {
+        return texture_loader;
+    }
+
+    // Per-frame texture updates (video, dynamic data) can be written here
+    // from any thread; they are uploaded at the start of the next frame
+    TextureStreamer& get_texture_streamer() {
+        return texture_streamer;
+    }
+
+    // Pixels can be read back without a pipeline stall by recording a
+    // ReadbackCommand against this queue; futures are resolved at the start
+    // of a later frame
+    ReadbackQueue& get_readback_queue() {
+        return readback_queue;
+    }
+
+    // Statistics for the most recently completed frame
+    const FrameStats& get_frame_stats() const {
+        return frame_stats;
     }
 
     ~GraphicsContext() {
-        SDL_GL_DeleteContext(this->wp.gl_context);
-        SDL_DestroyTexture(render_texture);
-        SDL_DestroyRenderer(this->wp.renderer);
-        SDL_DestroyWindow(this->wp.window);
+        uniform_buffer.destroy();
+        shader_watcher.clear();
+        texture_loader.shutdown();
+        texture_loader.clear();
+        texture_streamer.destroy();
+        readback_queue.destroy();
+        if (headless) {
+            headless_context.destroy();
+        } else {
+            SDL_GL_DeleteContext(this->wp.gl_context);
+            SDL_DestroyWindow(this->wp.window);
+        }
         IMG_Quit();
         SDL_Quit();
     }
   private:
-    void set_gl_attributes(const std::string& version) {
+    void create_window(const int& major, const int& minor) {
+        this->wp.window =
+            SDL_CreateWindow("SDF Renderer", SDL_WINDOWPOS_UNDEFINED,
+                             SDL_WINDOWPOS_UNDEFINED,
+                             this->wp.width,
+                             this->wp.height,
+                             SDL_WINDOW_OPENGL | SDL_WINDOW_SHOWN);
+
+
+        set_gl_attributes(major, minor);
+        this->wp.gl_context = SDL_GL_CreateContext(this->wp.window);
+        if (this->wp.gl_context == NULL) {
+            DEBUG("OpenGL context could not be created!");
+            exit(1);
+        }
+        SDL_GL_MakeCurrent(this->wp.window, this->wp.gl_context);
+        SDL_GL_SetSwapInterval(1);
+    }
+
+    void create_headless_context(const int& major, const int& minor) {
+        if (!headless_context.create(major, minor)) {
+            ERROR("Headless OpenGL context could not be created!");
+            exit(1);
+        }
+    }
+
+    void set_gl_attributes(const int& major, const int& minor) {
         SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK,
                             SDL_GL_CONTEXT_PROFILE_CORE);
 
-        // TODO: Replace with something more elegant
-        assert(version.size() == 3);
-        SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION,
-                            (int)(version[0] - '0'));
-        SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION,
-                            (int)(version[2] - '0'));
+        SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, major);
+        SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, minor);
 
         SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
     }
 
     long mainloop(Renderer& renderer) {
+        if (stop_requested.load() ||
+                (max_frames > 0 && frames_rendered >= max_frames)) {
+            return -1;
+        }
+
         auto start = GET_TIME();
+        size_t allocations = AllocationStats::count();
         SDL_Event event;
-        while (SDL_PollEvent(&event)) {
+        while (!headless && SDL_PollEvent(&event)) {
             handler.on_event(event, &wp);
             if (event.type == SDL_QUIT)
                 return -1;
         }
 
         GLContext::gl_refresh();
-        float viewport[4] = {0, 0, WIDTH, HEIGHT};
-        DrawCommand::set_uniform("chml_viewport", viewport);
-        auto surface_ptr = std::static_pointer_cast<AbstractSurface>(
-                               std::shared_ptr<DummyFramebuffer>(
-                                   new DummyFramebuffer(viewport[2],
-                                           viewport[3])));
-        auto command_list = renderer(surface_ptr);
-
-        for (auto command : command_list) {
-            if (typeid(*command) == typeid(DrawCommand)) {
-                auto draw_command = std::static_pointer_cast<DrawCommand>(
-                                        command);
-                auto new_render_state = draw_command->get_render_state();
-                this->render_state.apply_diff(new_render_state);
-                render_state = new_render_state;
-            }
-            (*command)();
-        }
-
-        SDL_GL_SwapWindow(this->wp.window);
+        GLState::reset_counters();
+        shader_watcher.update();
+        frame_stats.textures_uploaded = texture_loader.update();
+        frame_stats.streamed_bytes = texture_streamer.flush();
+        readback_queue.poll();
+        DrawCommand::set_frame_viewport(
+            glm::vec4(0, 0, default_surface->get_width(),
+                      default_surface->get_height()));
+
+        uniform_buffer.begin_frame();
+        renderer.record(default_surface, frame_commands);
+
+        // Shared uniforms are written once and read by every program
+        UniformRingBuffer::bind(
+            uniform_buffer.push(DrawCommand::get_frame_block()),
+            FRAME_BLOCK_BINDING);
+
+        if (sort_commands) {
+            bucket.clear();
+            bucket.add(frame_commands.commands());
+            bucket.sort(sorted_commands);
+            executor.execute(sorted_commands);
+            sorted_commands.clear();
+            bucket.clear();
+        } else {
+            executor.execute(frame_commands.commands());
+        }
+        frame_commands.clear();
+        uniform_buffer.end_frame();
+
+        // Headless frames stay in the default surface's framebuffer
+        if (!headless) {
+            SDL_GL_SwapWindow(this->wp.window);
+        }
+        frames_rendered++;
+
+        frame_stats.arena_bytes = arena.bytes_used();
+        frame_stats.elided_binds = GLState::elided_count();
+        arena.reset();
+        frame_stats.heap_allocations = AllocationStats::count() - allocations;
 
         auto end = GET_TIME();
         unsigned long diff = DIFF(end, start);
-        if (diff < IDEAL_FRAME_TIME) {
+        // Headless frames are not paced, so batch renders run flat out
+        if (!headless && diff < IDEAL_FRAME_TIME) {
             std::this_thread::sleep_for(std::chrono::milliseconds(
                                             IDEAL_FRAME_TIME - diff));
         }
@@ -181,10 +339,32 @@ class GraphicsContext {
         }
     }
 
-    SDL_Texture* render_texture;
     SDL::WindowParams wp;
 
-    RenderState render_state;
+    CommandExecutor executor;
+
+    // Opt-in reordering of each frame's draws to minimize state changes
+    bool sort_commands;
+    CommandBucket bucket;
+    CommandList sorted_commands;
+
+    // Commands recorded each frame are constructed in the arena, which is
+    // reset once the frame has been presented
+    FrameArena arena;
+    FrameCommandList frame_commands;
+    AbstractSurfacePtr default_surface;
+    UniformRingBuffer uniform_buffer;
+    ShaderWatcher shader_watcher;
+    TextureLoader texture_loader;
+    TextureStreamer texture_streamer;
+    ReadbackQueue readback_queue;
+    FrameStats frame_stats;
+
+    bool headless;
+    HeadlessContext headless_context;
+    int max_frames;
+    int frames_rendered;
+    std::atomic<bool> stop_requested;
 
     EventHandler& handler;
 
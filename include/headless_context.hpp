@@ -0,0 +1,201 @@
+//
+// ChameleonGL - A small framework for OpenGL.
+// Copyright (C) 2012-2017 Srinivas Kaza
+//
+// This file is part of ChameleonGL.
+//
+// ChameleonGL is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ChameleonGL is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ChameleonGL.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#ifdef CHML_HAVE_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+#include "util.hpp"
+
+// An OpenGL context without a window, for machines without a display.
+// Rendering goes to framebuffer objects only. The context is created with
+// EGL, preferring Mesa's surfaceless platform (which falls back to
+// llvmpipe on machines without a GPU) and then the default display with a
+// 1x1 pbuffer. Only available when built with CHML_HAVE_EGL.
+class HeadlessContext {
+  public:
+    HeadlessContext()
+#ifdef CHML_HAVE_EGL
+        :
+        _display(EGL_NO_DISPLAY),
+        _surface(EGL_NO_SURFACE),
+        _context(EGL_NO_CONTEXT)
+#endif
+    {
+
+    }
+
+    HeadlessContext(const HeadlessContext& other) = delete;
+    HeadlessContext& operator=(const HeadlessContext& other) = delete;
+
+    ~HeadlessContext() {
+        destroy();
+    }
+
+    // Creates a core profile context of `major`.`minor` and makes it
+    // current. Returns false, after reporting why, if that is not possible.
+    bool create(const int& major, const int& minor) {
+#ifdef CHML_HAVE_EGL
+        _display = surfaceless_display();
+        bool surfaceless = (_display != EGL_NO_DISPLAY);
+        if (!surfaceless) {
+            _display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+        }
+        if (_display == EGL_NO_DISPLAY ||
+                !eglInitialize(_display, nullptr, nullptr)) {
+            ERROR("Could not initialize an EGL display! Error: " <<
+                  eglGetError());
+            _display = EGL_NO_DISPLAY;
+            return false;
+        }
+
+        if (!eglBindAPI(EGL_OPENGL_API)) {
+            ERROR("EGL does not support desktop OpenGL!");
+            destroy();
+            return false;
+        }
+
+        const EGLint config_attribs[] = {
+            EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+            EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+            EGL_RED_SIZE, 8,
+            EGL_GREEN_SIZE, 8,
+            EGL_BLUE_SIZE, 8,
+            EGL_ALPHA_SIZE, 8,
+            EGL_NONE
+        };
+        EGLConfig config;
+        EGLint num_configs = 0;
+        if (!eglChooseConfig(_display, config_attribs, &config, 1,
+                             &num_configs) || num_configs == 0) {
+            ERROR("No EGL config supports OpenGL pbuffers!");
+            destroy();
+            return false;
+        }
+
+        const EGLint context_attribs[] = {
+            EGL_CONTEXT_MAJOR_VERSION, major,
+            EGL_CONTEXT_MINOR_VERSION, minor,
+            EGL_CONTEXT_OPENGL_PROFILE_MASK,
+            EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+            EGL_NONE
+        };
+        _context = eglCreateContext(_display, config, EGL_NO_CONTEXT,
+                                    context_attribs);
+        if (_context == EGL_NO_CONTEXT) {
+            ERROR("Could not create an OpenGL " << major << "." << minor <<
+                  " context! Error: " << eglGetError());
+            destroy();
+            return false;
+        }
+
+        // Contexts on the surfaceless platform may be made current without
+        // a surface; anywhere else a tiny pbuffer stands in for one
+        if (!surfaceless || !has_extension(
+                    eglQueryString(_display, EGL_EXTENSIONS),
+                    "EGL_KHR_surfaceless_context")) {
+            const EGLint pbuffer_attribs[] = {
+                EGL_WIDTH, 1,
+                EGL_HEIGHT, 1,
+                EGL_NONE
+            };
+            _surface = eglCreatePbufferSurface(_display, config,
+                                               pbuffer_attribs);
+            if (_surface == EGL_NO_SURFACE) {
+                ERROR("Could not create an EGL pbuffer! Error: " <<
+                      eglGetError());
+                destroy();
+                return false;
+            }
+        }
+
+        if (!eglMakeCurrent(_display, _surface, _surface, _context)) {
+            ERROR("Could not make the EGL context current! Error: " <<
+                  eglGetError());
+            destroy();
+            return false;
+        }
+        return true;
+#else
+        ERROR("Headless rendering needs ChameleonGL to be built with EGL");
+        return false;
+#endif
+    }
+
+    void destroy() {
+#ifdef CHML_HAVE_EGL
+        if (_display == EGL_NO_DISPLAY) {
+            return;
+        }
+        eglMakeCurrent(_display, EGL_NO_SURFACE, EGL_NO_SURFACE,
+                       EGL_NO_CONTEXT);
+        if (_context != EGL_NO_CONTEXT) {
+            eglDestroyContext(_display, _context);
+            _context = EGL_NO_CONTEXT;
+        }
+        if (_surface != EGL_NO_SURFACE) {
+            eglDestroySurface(_display, _surface);
+            _surface = EGL_NO_SURFACE;
+        }
+        eglTerminate(_display);
+        _display = EGL_NO_DISPLAY;
+#endif
+    }
+
+  private:
+#ifdef CHML_HAVE_EGL
+    static EGLDisplay surfaceless_display() {
+        const char* client_extensions =
+            eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+        if (!has_extension(client_extensions,
+                           "EGL_MESA_platform_surfaceless")) {
+            return EGL_NO_DISPLAY;
+        }
+
+        PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display =
+            (PFNEGLGETPLATFORMDISPLAYEXTPROC)
+            eglGetProcAddress("eglGetPlatformDisplayEXT");
+        if (get_platform_display == nullptr) {
+            return EGL_NO_DISPLAY;
+        }
+        return get_platform_display(EGL_PLATFORM_SURFACELESS_MESA,
+                                    EGL_DEFAULT_DISPLAY, nullptr);
+    }
+
+    // Extension strings are space separated names
+    static bool has_extension(const char* extensions, const std::string& name) {
+        if (extensions == nullptr) {
+            return false;
+        }
+        const std::string list = std::string(" ") + extensions + " ";
+        return list.find(" " + name + " ") != std::string::npos;
+    }
+
+    EGLDisplay _display;
+    EGLSurface _surface;
+    EGLContext _context;
+#endif
+};
@@ -22,6 +22,7 @@
 
 #include <vector>
 #include <exception>
+#include <stdexcept>
 #include <assert.h>
 
 // OpenGL / glew Headers
@@ -32,6 +33,7 @@
 #include "SDL2/SDL_image.h"
 
 #include "util.hpp"
+#include "pixel_convert.hpp"
 
 class ImageData {
   public:
@@ -73,61 +75,40 @@ class ImagePool {
     }
 
     int add(std::string filename) {
-        SDL_Surface* surface = IMG_Load(filename.c_str());
+        ImageData d = decode(filename);
 
-        SDL_PixelFormat* fmt = surface->format;
-        const int num_bytes = surface->h * surface->pitch;
-        uint8_t* data = new uint8_t[num_bytes];
+        for (auto it = pool.begin(); it != pool.end(); ++it) {
+            if (it->data == NULL) {
+                *it = d;
+                return (int)(it - pool.begin());
+            }
+        }
 
-        assert(fmt->palette == NULL);
-        assert(num_bytes == surface->w * surface->h * fmt->BytesPerPixel);
+        pool.push_back(d);
+        return pool.size() - 1;
+    }
 
-        uint32_t pixel, temp;
-        uint8_t red, green, blue, alpha;
-        SDL_LockSurface(surface);
+    void remove(const int& index) {
+        delete[] (uint8_t*) pool[index].data;
+        pool[index].data = NULL;
+    }
 
-        for (size_t j = 0; j < surface->h; j++) {
-            for (size_t i = 0; i < surface->w; i++) {
-                size_t byte_offset = (i + j * surface->w) * fmt->BytesPerPixel;
-
-                uint8_t* tmp = new uint8_t[sizeof(uint32_t)];
-                for (int i = 0; i < fmt->BytesPerPixel; i++) {
-                    tmp[i] = ((uint8_t*) surface->pixels)[byte_offset + i];
-                }
-                pixel = *(uint32_t*) tmp;
-
-                temp = pixel & fmt->Rmask;
-                temp = temp >> fmt->Rshift;
-                temp = temp << fmt->Rloss;
-                red = (uint8_t) temp;
-                data[byte_offset] = red;
-
-                if (fmt->BytesPerPixel > 1) {
-                    temp = pixel & fmt->Gmask;
-                    temp = temp >> fmt->Gshift;
-                    temp = temp << fmt->Gloss;
-                    green = (uint8_t) temp;
-                    data[byte_offset + 1] = green;
-
-                    if (fmt->BytesPerPixel > 2) {
-                        temp = pixel & fmt->Bmask;
-                        temp = temp >> fmt->Bshift;
-                        temp = temp << fmt->Bloss;
-                        blue = (uint8_t) temp;
-                        data[byte_offset + 2] = blue;
-
-                        if (fmt->BytesPerPixel > 3) {
-                            temp = pixel & fmt->Amask;
-                            temp = temp >> fmt->Ashift;
-                            temp = temp << fmt->Aloss;
-                            alpha = (uint8_t) temp;
-                            data[byte_offset + 3] = alpha;
-                        }
-                    }
-                }
-            }
+    ImageData get(const int& index) {
+        return pool[index];
+    }
+
+    // Loads and converts an image without touching GL or the pool, so it
+    // may run on any thread. The caller owns the returned data, which is
+    // allocated with new[].
+    static ImageData decode(const std::string& filename) {
+        SDL_Surface* surface = IMG_Load(filename.c_str());
+        if (surface == NULL) {
+            throw std::runtime_error("Could not load image " + filename +
+                                     ": " + IMG_GetError());
         }
-        SDL_UnlockSurface(surface);
+
+        SDL_PixelFormat* fmt = surface->format;
+        assert(fmt->palette == NULL);
 
         GLenum gl_fmt;
         switch (fmt->BytesPerPixel) {
@@ -144,31 +125,34 @@ class ImagePool {
             gl_fmt = GL_RGBA;
             break;
         default:
+            SDL_FreeSurface(surface);
             throw std::runtime_error("Invalid pixel format!");
         }
 
-        ImageData d(surface->w, surface->h, fmt->BytesPerPixel, gl_fmt, data);
-
-        for (auto it = pool.begin(); it != pool.end(); ++it) {
-            if (it->data == NULL) {
-                *it = d;
-                return (int)(it - pool.begin());
-            }
-        }
-        SDL_FreeSurface(surface);
+        const int num_bytes = surface->w * surface->h * fmt->BytesPerPixel;
+        uint8_t* data = new uint8_t[num_bytes];
 
-        pool.push_back(d);
-        return pool.size() - 1;
-    }
+        SDL_LockSurface(surface);
+        PixelConverter::convert(channel_layout(fmt),
+                                (const uint8_t*) surface->pixels,
+                                surface->pitch,
+                                surface->w,
+                                surface->h,
+                                data);
+        SDL_UnlockSurface(surface);
 
-    void remove(const int& index) {
-        ImageData data = pool[index];
-        free(data.data);
-        data.data = NULL;
+        ImageData d(surface->w, surface->h, fmt->BytesPerPixel, gl_fmt, data);
+        SDL_FreeSurface(surface);
+        return d;
     }
 
-    ImageData get(const int& index) {
-        return pool[index];
+    static ChannelLayout channel_layout(const SDL_PixelFormat* fmt) {
+        return ChannelLayout({
+            fmt->BytesPerPixel,
+            {fmt->Rmask, fmt->Gmask, fmt->Bmask, fmt->Amask},
+            {fmt->Rshift, fmt->Gshift, fmt->Bshift, fmt->Ashift},
+            {fmt->Rloss, fmt->Gloss, fmt->Bloss, fmt->Aloss}
+        });
     }
 
   private:
@@ -164,15 +164,9 @@ class InputController : public EventHandler {
         this->view = view;
 
         glm::vec3 origin(glm::inverse(view) * glm::vec4(0, 0, 0, 1));
-        glm::mat4 inverse_view_projection(glm::inverse(projection * view));
-
-        DrawCommand::set_uniform("chml_model", model);
-        DrawCommand::set_uniform("chml_projection", projection);
-        DrawCommand::set_uniform("chml_view", view);
-        DrawCommand::set_uniform("chml_origin", origin);
-        DrawCommand::set_uniform("chml_inverse_view_projection",
-                                 inverse_view_projection);
-        DrawCommand::set_uniform("chml_near", NEAR_PLANE);
+
+        DrawCommand::set_uniform("chml_model"_u, model);
+        DrawCommand::set_frame_camera(view, projection, origin, NEAR_PLANE);
 
         current_mouse_position = center;
     };
@@ -19,25 +19,61 @@
 //
 
 #pragma once
-#define TINYOBJLOADER_IMPLEMENTATION
 
 #include <vector>
+#include <unordered_map>
 #include <exception>
+#include <cstddef>
+#include <limits>
+#include <algorithm>
+#include <sys/stat.h>
 #include <assert.h>
 
 #include <glm/glm.hpp>
 #include <glm/gtx/transform.hpp>
 
-#include "tiny_obj_loader.h"
+#include "obj_parser.hpp"
 
 #include "util.hpp"
 #include "opengl_utils.hpp"
 #include "drawable.hpp"
+#include "mesh_file.hpp"
+
+const std::string MESH_EXTENSION = ".mesh";
+
+// Hashes the (vertex, normal, texcoord) triple of an OBJ face corner, so
+// that corners shared between faces become a single vertex
+struct ObjIndexHash {
+    size_t operator()(const tinyobj::index_t& idx) const {
+        size_t h = std::hash<int>()(idx.vertex_index);
+        h = h * 31 + std::hash<int>()(idx.normal_index);
+        h = h * 31 + std::hash<int>()(idx.texcoord_index);
+        return h;
+    }
+};
+
+struct ObjIndexEqual {
+    bool operator()(const tinyobj::index_t& a,
+                    const tinyobj::index_t& b) const {
+        return a.vertex_index == b.vertex_index &&
+               a.normal_index == b.normal_index &&
+               a.texcoord_index == b.texcoord_index;
+    }
+};
+
+// Interleaved vertex uploaded by Mesh::load, 20 bytes in total. The normal
+// is packed as GL_INT_2_10_10_10_REV and the texcoord as two half floats.
+struct MeshVertex {
+    glm::vec3 position;
+    GLuint normal;
+    GLuint uv;
+};
 
-// Unoptimized mesh implementation
 class Mesh : public Drawable {
   public:
-    Mesh() {
+    Mesh() :
+        bounds_min(0.0f),
+        bounds_max(0.0f) {
     }
 
     Mesh(const std::string filename) : Mesh() {
@@ -48,73 +84,159 @@ class Mesh : public Drawable {
         load_from_vao(vao);
     }
 
+    // Loads an OBJ file through its binary conversion, `filename` + ".mesh",
+    // which is written on the first load and rewritten whenever the OBJ
+    // changes. Files already in the binary format are loaded directly.
     void load(const std::string& filename) {
-        tinyobj::attrib_t attrib;
-        std::vector<tinyobj::shape_t> shapes;
-        std::vector<tinyobj::material_t> materials;
-
-        std::string err;
-        bool ret = tinyobj::LoadObj(&attrib, &shapes, &materials, &err,
-                                    filename.c_str(), "assets/",
-                                    true);
-        if (!err.empty()) {
-            throw std::runtime_error("Error in tinyobj: " + err);
+        if (ends_with(filename, MESH_EXTENSION)) {
+            MeshFile file;
+            if (!file.open(filename)) {
+                throw std::runtime_error("Could not read mesh " + filename);
+            }
+            load_from_file(file);
+            return;
+        }
+
+        struct stat st;
+        if (stat(filename.c_str(), &st) != 0) {
+            throw std::runtime_error("Could not find mesh " + filename);
         }
 
+        std::string cache = filename + MESH_EXTENSION;
+        MeshFile file;
+        if (file.open(cache) &&
+                file.matches_source(st.st_size, st.st_mtime)) {
+            DEBUG("Loading cached model " << cache);
+            load_from_file(file);
+            return;
+        }
+
+        MeshData data = parse_obj(filename);
+        if (!MeshFile::write(cache, data, st.st_size, st.st_mtime)) {
+            DEBUG("Could not write mesh cache " << cache);
+        }
+        load_from_data(data);
+    }
+
+    // Parses an OBJ file into interleaved MeshVertex records. Meshlets of
+    // MESHLET_TRIANGLES consecutive triangles are built if asked for.
+    static MeshData parse_obj(const std::string& filename,
+                              const bool& build_meshlets = false) {
         DEBUG("Loading model...");
 
-        std::vector<glm::vec4> positions;
-        std::vector<glm::vec2> uvs;
-        std::vector<glm::vec4> normals;
-
-        for (size_t s = 0; s < shapes.size(); s++) {
-            size_t index_offset = 0;
-            for (size_t f = 0; f < shapes[s].mesh.num_face_vertices.size(); f++) {
-                int fv = shapes[s].mesh.num_face_vertices[f];
-                assert(fv == 3);
-
-                for (size_t v = 0; v < fv; v++) {
-                    tinyobj::index_t idx = shapes[s].mesh.indices[index_offset + v];
-
-                    glm::vec4 v_pos;
-                    v_pos.x = attrib.vertices[3 * idx.vertex_index + 0];
-                    v_pos.y = attrib.vertices[3 * idx.vertex_index + 1];
-                    v_pos.z = attrib.vertices[3 * idx.vertex_index + 2];
-                    v_pos.w = 0.0;
-
-                    glm::vec4 v_normal;
-                    v_normal.x = attrib.vertices[3 * idx.normal_index + 0];
-                    v_normal.y = attrib.vertices[3 * idx.normal_index + 1];
-                    v_normal.z = attrib.vertices[3 * idx.normal_index + 2];
-                    v_normal.w = 0.0;
-
-                    glm::vec2 v_texcoord;
-                    v_texcoord.x = attrib.vertices[3 * idx.texcoord_index + 0];
-                    v_texcoord.y = attrib.vertices[3 * idx.texcoord_index + 1];
-
-                    positions.push_back(v_pos);
-                    normals.push_back(v_normal);
-                    uvs.push_back(v_texcoord);
-                }
-                DEBUG("");
-                index_offset += fv;
+        ObjData obj = ObjParser::parse(filename);
+        const tinyobj::attrib_t& attrib = obj.attrib;
+
+        // Every face is already a triangle, so the index count is known up
+        // front. Most corners share their position's normal and texcoord,
+        // so the position count is a good guess for the vertex count.
+        const size_t num_indices = obj.indices.size();
+        const size_t num_positions = attrib.vertices.size() / 3;
+        std::vector<GLuint> indices(num_indices);
+        std::vector<MeshVertex> vertices;
+        vertices.reserve(num_positions);
+        std::unordered_map<tinyobj::index_t, GLuint,
+            ObjIndexHash, ObjIndexEqual> unique_vertices;
+        unique_vertices.reserve(num_positions);
+
+        const size_t progress_step = std::max<size_t>(num_indices / 10, 1);
+        for (size_t i = 0; i < num_indices; i++) {
+            if (i % progress_step == 0) {
+                VERBOSE("Loading model: " << (100 * i / num_indices) << "%");
+            }
+
+            const tinyobj::index_t& idx = obj.indices[i];
+
+            auto found = unique_vertices.find(idx);
+            if (found != unique_vertices.end()) {
+                indices[i] = found->second;
+                continue;
             }
+
+            glm::vec3 v_pos;
+            v_pos.x = attrib.vertices[3 * idx.vertex_index + 0];
+            v_pos.y = attrib.vertices[3 * idx.vertex_index + 1];
+            v_pos.z = attrib.vertices[3 * idx.vertex_index + 2];
+
+            // Normals and texcoords are optional in OBJ files
+            glm::vec3 v_normal(0.0);
+            if (idx.normal_index >= 0) {
+                v_normal.x = attrib.normals[3 * idx.normal_index + 0];
+                v_normal.y = attrib.normals[3 * idx.normal_index + 1];
+                v_normal.z = attrib.normals[3 * idx.normal_index + 2];
+            }
+
+            glm::vec2 v_texcoord(0.0);
+            if (idx.texcoord_index >= 0) {
+                v_texcoord.x = attrib.texcoords[2 * idx.texcoord_index + 0];
+                v_texcoord.y = attrib.texcoords[2 * idx.texcoord_index + 1];
+            }
+
+            GLuint index = vertices.size();
+            unique_vertices.emplace(idx, index);
+            indices[i] = index;
+
+            vertices.push_back(MeshVertex({
+                v_pos, pack_normal(v_normal), pack_half2(v_texcoord)
+            }));
         }
         DEBUG("Loading complete!");
 
-        const std::vector<VertexAttribute> attribs({
-            {0, 4, 0, 0},
-            {1, 4, 0, 0},
-            {2, 2, 0, 0},
+        MeshData data;
+        data.vertex_size = sizeof(MeshVertex);
+        data.formats = std::vector<VertexFormat>({
+            {0, 3, GL_FLOAT, GL_FALSE, offsetof(MeshVertex, position)},
+            {1, 4, GL_INT_2_10_10_10_REV, GL_TRUE,
+             offsetof(MeshVertex, normal)},
+            {2, 2, GL_HALF_FLOAT, GL_FALSE, offsetof(MeshVertex, uv)},
         });
-        std::vector<GLfloat*> vertex_data;
-        vertex_data.push_back(&(positions[0].x));
-        vertex_data.push_back(&(normals[0].x));
-        vertex_data.push_back(&(uvs[0].x));
-        this->vao = VAO(vertex_data,
-                        attribs,
-                        positions.size(),
-                        GL_TRIANGLES);
+        data.num_vertices = vertices.size();
+        data.vertices = std::vector<uint8_t>(
+                            (const uint8_t*) vertices.data(),
+                            (const uint8_t*)(vertices.data() +
+                                             vertices.size()));
+
+        data.index_type = VAO::index_type_for(vertices.size());
+        data.num_indices = indices.size();
+        if (data.index_type == GL_UNSIGNED_SHORT) {
+            std::vector<GLushort> short_indices(indices.begin(),
+                                                indices.end());
+            data.indices = std::vector<uint8_t>(
+                               (const uint8_t*) short_indices.data(),
+                               (const uint8_t*)(short_indices.data() +
+                                                short_indices.size()));
+        } else {
+            data.indices = std::vector<uint8_t>(
+                               (const uint8_t*) indices.data(),
+                               (const uint8_t*)(indices.data() +
+                                                indices.size()));
+        }
+
+        data.bounds_min = glm::vec3(std::numeric_limits<float>::max());
+        data.bounds_max = glm::vec3(-std::numeric_limits<float>::max());
+        for (const MeshVertex& vertex : vertices) {
+            data.bounds_min = glm::min(data.bounds_min, vertex.position);
+            data.bounds_max = glm::max(data.bounds_max, vertex.position);
+        }
+
+        if (build_meshlets) {
+            data.meshlets = make_meshlets(vertices, indices);
+        }
+        return data;
+    }
+
+
+    const glm::vec3& get_bounds_min() const {
+        return bounds_min;
+    }
+
+    const glm::vec3& get_bounds_max() const {
+        return bounds_max;
+    }
+
+    // Empty unless the mesh was converted with meshlets
+    const std::vector<Meshlet>& get_meshlets() const {
+        return meshlets;
     }
 
     void load_from_vao(VAO& vao) {
@@ -141,6 +263,75 @@ class Mesh : public Drawable {
         return vao;
     };
 
+    constexpr static size_t MESHLET_TRIANGLES = 64;
+
   private:
+    void load_from_file(const MeshFile& file) {
+        this->vao = VAO(file.vertex_data(),
+                        file.vertex_size(),
+                        file.formats(),
+                        file.num_vertices(),
+                        file.index_data(),
+                        file.num_indices(),
+                        file.index_type(),
+                        GL_TRIANGLES);
+        bounds_min = file.bounds_min();
+        bounds_max = file.bounds_max();
+        meshlets = file.meshlets();
+    }
+
+    void load_from_data(const MeshData& data) {
+        this->vao = VAO(data.vertices.data(),
+                        data.vertex_size,
+                        data.formats,
+                        data.num_vertices,
+                        data.indices.data(),
+                        data.num_indices,
+                        data.index_type,
+                        GL_TRIANGLES);
+        bounds_min = data.bounds_min;
+        bounds_max = data.bounds_max;
+        meshlets = data.meshlets;
+    }
+
+    static std::vector<Meshlet> make_meshlets(
+        const std::vector<MeshVertex>& vertices,
+        const std::vector<GLuint>& indices) {
+        std::vector<Meshlet> meshlets;
+        const size_t meshlet_indices = MESHLET_TRIANGLES * 3;
+        for (size_t start = 0; start < indices.size();
+                start += meshlet_indices) {
+            size_t end = std::min(start + meshlet_indices, indices.size());
+
+            glm::vec3 lo(std::numeric_limits<float>::max());
+            glm::vec3 hi(-std::numeric_limits<float>::max());
+            for (size_t i = start; i < end; i++) {
+                lo = glm::min(lo, vertices[indices[i]].position);
+                hi = glm::max(hi, vertices[indices[i]].position);
+            }
+
+            glm::vec3 center = (lo + hi) * 0.5f;
+            float radius = 0.0f;
+            for (size_t i = start; i < end; i++) {
+                radius = std::max(radius, glm::length(
+                                      vertices[indices[i]].position - center));
+            }
+
+            meshlets.push_back(Meshlet({
+                (uint32_t) start, (uint32_t)(end - start),
+                glm::vec4(center, radius)
+            }));
+        }
+        return meshlets;
+    }
+
+    static bool ends_with(const std::string& s, const std::string& suffix) {
+        return s.size() >= suffix.size() &&
+               s.compare(s.size() - suffix.size(), suffix.size(), suffix) == 0;
+    }
+
     VAO vao;
+    glm::vec3 bounds_min;
+    glm::vec3 bounds_max;
+    std::vector<Meshlet> meshlets;
 };
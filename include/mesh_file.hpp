@@ -0,0 +1,359 @@
+//
+// ChameleonGL - A small framework for OpenGL.
+// Copyright (C) 2012-2017 Srinivas Kaza
+//
+// This file is part of ChameleonGL.
+//
+// ChameleonGL is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ChameleonGL is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ChameleonGL.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <glm/glm.hpp>
+
+#include "util.hpp"
+#include "opengl_utils.hpp"
+
+// A run of triangles with a bounding sphere, for culling parts of a mesh
+typedef struct {
+    uint32_t index_offset;
+    uint32_t index_count;
+    // xyz is the center, w the radius
+    glm::vec4 bounds;
+} Meshlet;
+
+// Interleaved mesh contents, ready to be uploaded. The indices are already
+// stored as `index_type` (GL_UNSIGNED_SHORT or GL_UNSIGNED_INT).
+typedef struct {
+    GLuint vertex_size;
+    std::vector<VertexFormat> formats;
+    GLuint num_vertices;
+    std::vector<uint8_t> vertices;
+    GLenum index_type;
+    GLuint num_indices;
+    std::vector<uint8_t> indices;
+    glm::vec3 bounds_min;
+    glm::vec3 bounds_max;
+    std::vector<Meshlet> meshlets;
+} MeshData;
+
+// Versioned binary mesh file. A file is a Header followed by the vertex
+// formats, the meshlets, the index buffer and the vertex blob, each section
+// starting on a 4 byte boundary. Files are memory mapped when read, so the
+// buffers can be handed to GL without any parsing or copying.
+//
+// The size and modification time of the source file are recorded, so that
+// a cached conversion can be checked against it, along with a checksum of
+// everything after the header.
+class MeshFile {
+  public:
+    MeshFile() :
+        _data(nullptr),
+        _size(0) {
+    }
+
+    MeshFile(const MeshFile& other) = delete;
+    MeshFile& operator=(const MeshFile& other) = delete;
+
+    ~MeshFile() {
+        close();
+    }
+
+    // Maps `filename`, returning false if it is missing, truncated or from
+    // another version of the format. With `verify` the checksum is checked
+    // too, which reads the whole file once.
+    bool open(const std::string& filename, const bool& verify = true) {
+        close();
+
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+
+        struct stat st;
+        if (fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(Header)) {
+            ::close(fd);
+            return false;
+        }
+
+        void* data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (data == MAP_FAILED) {
+            return false;
+        }
+
+        _data = (const uint8_t*) data;
+        _size = st.st_size;
+        if (header().magic != MAGIC || header().version != VERSION ||
+                end_offset(header()) > _size) {
+            close();
+            return false;
+        }
+        if (verify && header().checksum !=
+                checksum(_data + sizeof(Header),
+                         end_offset(header()) - sizeof(Header))) {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    void close() {
+        if (_data != nullptr) {
+            munmap((void*) _data, _size);
+            _data = nullptr;
+            _size = 0;
+        }
+    }
+
+    bool is_open() const {
+        return _data != nullptr;
+    }
+
+    // Whether the file was converted from a source of this size and
+    // modification time
+    bool matches_source(const uint64_t& source_size,
+                        const int64_t& source_mtime) const {
+        return header().source_size == source_size &&
+               header().source_mtime == source_mtime;
+    }
+
+    GLuint vertex_size() const {
+        return header().vertex_size;
+    }
+
+    GLuint num_vertices() const {
+        return header().num_vertices;
+    }
+
+    GLenum index_type() const {
+        return header().index_type;
+    }
+
+    GLuint num_indices() const {
+        return header().num_indices;
+    }
+
+    glm::vec3 bounds_min() const {
+        return glm::vec3(header().bounds_min[0],
+                         header().bounds_min[1],
+                         header().bounds_min[2]);
+    }
+
+    glm::vec3 bounds_max() const {
+        return glm::vec3(header().bounds_max[0],
+                         header().bounds_max[1],
+                         header().bounds_max[2]);
+    }
+
+    std::vector<VertexFormat> formats() const {
+        std::vector<VertexFormat> formats(header().num_formats);
+        const uint32_t* packed =
+            (const uint32_t*)(_data + formats_offset(header()));
+        for (size_t i = 0; i < formats.size(); i++) {
+            const uint32_t* format = packed + i * FORMAT_WORDS;
+            formats[i] = VertexFormat({
+                format[0], (GLint) format[1], format[2],
+                (GLboolean) format[3], format[4]
+            });
+        }
+        return formats;
+    }
+
+    std::vector<Meshlet> meshlets() const {
+        const Meshlet* first =
+            (const Meshlet*)(_data + meshlets_offset(header()));
+        return std::vector<Meshlet>(first, first + header().num_meshlets);
+    }
+
+    const void* index_data() const {
+        return _data + indices_offset(header());
+    }
+
+    const void* vertex_data() const {
+        return _data + vertices_offset(header());
+    }
+
+    static bool write(const std::string& filename,
+                      const MeshData& mesh,
+                      const uint64_t& source_size,
+                      const int64_t& source_mtime) {
+        Header header;
+        std::memset(&header, 0, sizeof(header));
+        header.magic = MAGIC;
+        header.version = VERSION;
+        header.source_size = source_size;
+        header.source_mtime = source_mtime;
+        header.vertex_size = mesh.vertex_size;
+        header.num_formats = mesh.formats.size();
+        header.num_vertices = mesh.num_vertices;
+        header.index_type = mesh.index_type;
+        header.num_indices = mesh.num_indices;
+        header.num_meshlets = mesh.meshlets.size();
+        for (int i = 0; i < 3; i++) {
+            header.bounds_min[i] = mesh.bounds_min[i];
+            header.bounds_max[i] = mesh.bounds_max[i];
+        }
+
+        std::vector<uint32_t> formats;
+        for (const VertexFormat& format : mesh.formats) {
+            formats.insert(formats.end(), {
+                format.index, (uint32_t) format.size, format.type,
+                (uint32_t) format.normalized, format.offset
+            });
+        }
+
+        std::vector<uint8_t> body(sizeof(Header));
+        append(body, formats.data(), formats.size() * sizeof(uint32_t));
+        append(body, mesh.meshlets.data(),
+               mesh.meshlets.size() * sizeof(Meshlet));
+        append(body, mesh.indices.data(), mesh.indices.size());
+        body.resize(sizeof(Header) + align(body.size() - sizeof(Header)), 0);
+        append(body, mesh.vertices.data(), mesh.vertices.size());
+        header.checksum = checksum(body.data() + sizeof(Header),
+                                   body.size() - sizeof(Header));
+        std::memcpy(body.data(), &header, sizeof(header));
+
+        // Written to a temporary file of its own first, so that a reader
+        // never sees a partial mesh and concurrent writers do not collide
+        std::string tmp = filename + ".XXXXXX";
+        int fd = mkstemp(&tmp[0]);
+        if (fd < 0) {
+            return false;
+        }
+        fchmod(fd, 0644);
+
+        bool written = write_all(fd, body.data(), body.size());
+        written = ::close(fd) == 0 && written;
+        if (!written || std::rename(tmp.c_str(), filename.c_str()) != 0) {
+            unlink(tmp.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    constexpr static uint32_t MAGIC = 0x4c4d4843; // "CHML"
+    constexpr static uint32_t VERSION = 2;
+
+  private:
+    typedef struct {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t source_size;
+        int64_t source_mtime;
+        // Of everything after the header
+        uint64_t checksum;
+        uint32_t vertex_size;
+        uint32_t num_formats;
+        uint32_t num_vertices;
+        uint32_t index_type;
+        uint32_t num_indices;
+        uint32_t num_meshlets;
+        float bounds_min[3];
+        float bounds_max[3];
+    } Header;
+
+    // index, size, type, normalized, offset
+    constexpr static size_t FORMAT_WORDS = 5;
+
+    const Header& header() const {
+        return *((const Header*) _data);
+    }
+
+    static size_t align(const size_t& offset) {
+        return (offset + 3) & ~((size_t) 3);
+    }
+
+    static void append(std::vector<uint8_t>& out,
+                       const void* data,
+                       const size_t& size) {
+        const uint8_t* bytes = (const uint8_t*) data;
+        out.insert(out.end(), bytes, bytes + size);
+    }
+
+    static bool write_all(const int& fd,
+                          const uint8_t* data,
+                          const size_t& size) {
+        size_t done = 0;
+        while (done < size) {
+            ssize_t n = ::write(fd, data + done, size - done);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return false;
+            }
+            done += (size_t) n;
+        }
+        return true;
+    }
+
+    // FNV-1a over 8 byte words, then over the bytes left at the end
+    static uint64_t checksum(const uint8_t* data, const size_t& size) {
+        uint64_t h = 0xcbf29ce484222325ULL;
+        size_t i = 0;
+        for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+            uint64_t word;
+            std::memcpy(&word, data + i, sizeof(word));
+            h = (h ^ word) * 0x100000001b3ULL;
+        }
+        for (; i < size; i++) {
+            h = (h ^ data[i]) * 0x100000001b3ULL;
+        }
+        return h;
+    }
+
+    static size_t index_bytes(const Header& header) {
+        return header.num_indices *
+               (header.index_type == GL_UNSIGNED_SHORT ? 2 : 4);
+    }
+
+    static size_t formats_offset(const Header& header) {
+        return sizeof(Header);
+    }
+
+    static size_t meshlets_offset(const Header& header) {
+        return formats_offset(header) +
+               header.num_formats * FORMAT_WORDS * sizeof(uint32_t);
+    }
+
+    static size_t indices_offset(const Header& header) {
+        return meshlets_offset(header) + header.num_meshlets * sizeof(Meshlet);
+    }
+
+    static size_t vertices_offset(const Header& header) {
+        return indices_offset(header) + align(index_bytes(header));
+    }
+
+    static size_t end_offset(const Header& header) {
+        return vertices_offset(header) +
+               (size_t) header.num_vertices * header.vertex_size;
+    }
+
+    const uint8_t* _data;
+    size_t _size;
+};
@@ -0,0 +1,332 @@
+//
+// ChameleonGL - A small framework for OpenGL.
+// Copyright (C) 2012-2017 Srinivas Kaza
+//
+// This file is part of ChameleonGL.
+//
+// ChameleonGL is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ChameleonGL is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ChameleonGL.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#pragma once
+#define TINYOBJLOADER_IMPLEMENTATION
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <functional>
+#include <algorithm>
+#include <stdexcept>
+#include <cstring>
+#include <cstdint>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "tiny_obj_loader.h"
+
+// Geometry of an OBJ file: the attribute arrays plus every face, fan
+// triangulated, in file order
+typedef struct {
+    tinyobj::attrib_t attrib;
+    std::vector<tinyobj::index_t> indices;
+} ObjData;
+
+// Parses the geometry of OBJ files (v, vn, vt and f records) on several
+// threads. The file is memory mapped and split into line-aligned chunks;
+// each chunk is parsed with tinyobj's own number parsing, so the result
+// matches tinyobj::LoadObj exactly. Groups, objects and materials are
+// ignored since Mesh draws every face the same way.
+class ObjParser {
+  public:
+    static ObjData parse(const std::string& filename,
+                         const size_t& num_threads =
+                             std::thread::hardware_concurrency()) {
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error("Could not open " + filename);
+        }
+
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            ::close(fd);
+            throw std::runtime_error("Could not stat " + filename);
+        }
+
+        ObjData data;
+        size_t size = st.st_size;
+        if (size == 0) {
+            ::close(fd);
+            return data;
+        }
+
+        void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (mapped == MAP_FAILED) {
+            throw std::runtime_error("Could not map " + filename);
+        }
+
+        data = parse((const char*) mapped, size, num_threads);
+        munmap(mapped, size);
+        return data;
+    }
+
+    static ObjData parse(const char* text,
+                         const size_t& size,
+                         const size_t& num_threads) {
+        std::vector<const char*> bounds = split(text, size,
+                                                std::max<size_t>(num_threads, 1));
+        std::vector<Chunk> chunks(bounds.size() - 1);
+
+        std::vector<std::thread> threads;
+        for (size_t i = 1; i < chunks.size(); i++) {
+            threads.push_back(std::thread(parse_chunk, bounds[i], bounds[i + 1],
+                                          std::ref(chunks[i])));
+        }
+        if (!chunks.empty()) {
+            parse_chunk(bounds[0], bounds[1], chunks[0]);
+        }
+        for (std::thread& thread : threads) {
+            thread.join();
+        }
+
+        return merge(chunks);
+    }
+
+    // The same geometry read through tinyobj::LoadObj on one thread, which
+    // parse() has to match
+    static ObjData parse_reference(const std::string& filename) {
+        std::vector<tinyobj::shape_t> shapes;
+        std::vector<tinyobj::material_t> materials;
+        std::string err;
+
+        ObjData data;
+        if (!tinyobj::LoadObj(&data.attrib, &shapes, &materials, &err,
+                              filename.c_str(), nullptr, true)) {
+            throw std::runtime_error("Error in tinyobj: " + err);
+        }
+        for (const tinyobj::shape_t& shape : shapes) {
+            data.indices.insert(data.indices.end(),
+                                shape.mesh.indices.begin(),
+                                shape.mesh.indices.end());
+        }
+        return data;
+    }
+
+  private:
+    enum RelativeIndex {
+        RELATIVE_VERTEX =   0b001,
+        RELATIVE_NORMAL =   0b010,
+        RELATIVE_TEXCOORD = 0b100
+    };
+
+    typedef struct {
+        std::vector<tinyobj::real_t> vertices;
+        std::vector<tinyobj::real_t> normals;
+        std::vector<tinyobj::real_t> texcoords;
+        std::vector<tinyobj::index_t> indices;
+        // RelativeIndex bits for each index, for indices given relative to
+        // the end of the attribute arrays. Those depend on the earlier
+        // chunks, so they are offset in merge(). Empty if there are none.
+        std::vector<uint8_t> relative;
+    } Chunk;
+
+    // Splits [text, text + size) into up to `num_chunks` pieces that start
+    // at the beginning of a line
+    static std::vector<const char*> split(const char* text,
+                                          const size_t& size,
+                                          const size_t& num_chunks) {
+        const char* end = text + size;
+        std::vector<const char*> bounds({text});
+        for (size_t i = 1; i < num_chunks; i++) {
+            const char* bound = std::max(text + size * i / num_chunks,
+                                         bounds.back());
+            const char* newline = (const char*)
+                                  std::memchr(bound, '\n', end - bound);
+            if (newline == nullptr || newline + 1 == end) {
+                break;
+            }
+            bounds.push_back(newline + 1);
+        }
+        bounds.push_back(end);
+        return bounds;
+    }
+
+    static void parse_chunk(const char* begin,
+                            const char* end,
+                            Chunk& chunk) {
+        // tinyobj's parsing helpers stop at the end of a C string, so each
+        // line is copied into a null-terminated buffer first
+        std::string line;
+        std::vector<tinyobj::index_t> face;
+        std::vector<uint8_t> face_relative;
+        const char* cursor = begin;
+        while (cursor < end) {
+            const char* newline = (const char*)
+                                  std::memchr(cursor, '\n', end - cursor);
+            const char* line_end = newline == nullptr ? end : newline;
+            line.assign(cursor, line_end);
+            cursor = line_end + 1;
+
+            if (!line.empty() && line.back() == '\r') {
+                line.pop_back();
+            }
+
+            const char* token = line.c_str();
+            token += strspn(token, " \t");
+
+            if (token[0] == 'v' && IS_SPACE(token[1])) {
+                token += 2;
+                tinyobj::real_t x, y, z;
+                tinyobj::parseReal3(&x, &y, &z, &token);
+                chunk.vertices.insert(chunk.vertices.end(), {x, y, z});
+            } else if (token[0] == 'v' && token[1] == 'n' &&
+                       IS_SPACE(token[2])) {
+                token += 3;
+                tinyobj::real_t x, y, z;
+                tinyobj::parseReal3(&x, &y, &z, &token);
+                chunk.normals.insert(chunk.normals.end(), {x, y, z});
+            } else if (token[0] == 'v' && token[1] == 't' &&
+                       IS_SPACE(token[2])) {
+                token += 3;
+                tinyobj::real_t x, y;
+                tinyobj::parseReal2(&x, &y, &token);
+                chunk.texcoords.insert(chunk.texcoords.end(), {x, y});
+            } else if (token[0] == 'f' && IS_SPACE(token[1])) {
+                token += 2;
+                token += strspn(token, " \t");
+
+                face.clear();
+                face_relative.clear();
+                while (!IS_NEW_LINE(token[0])) {
+                    uint8_t relative = 0;
+                    face.push_back(parse_index(&token, chunk, relative));
+                    face_relative.push_back(relative);
+                    token += strspn(token, " \t\r");
+                }
+
+                add_face(face, face_relative, chunk);
+            }
+        }
+    }
+
+    // Like tinyobj's parseTriple, except that relative indices are resolved
+    // against this chunk's counts and flagged in `relative`
+    static tinyobj::index_t parse_index(const char** token,
+                                        const Chunk& chunk,
+                                        uint8_t& relative) {
+        tinyobj::vertex_index raw = tinyobj::parseRawTriple(token);
+
+        tinyobj::index_t idx;
+        idx.vertex_index = fix_index(raw.v_idx, chunk.vertices.size() / 3,
+                                     RELATIVE_VERTEX, relative);
+        idx.normal_index = fix_index(raw.vn_idx, chunk.normals.size() / 3,
+                                     RELATIVE_NORMAL, relative);
+        idx.texcoord_index = fix_index(raw.vt_idx, chunk.texcoords.size() / 2,
+                                       RELATIVE_TEXCOORD, relative);
+        return idx;
+    }
+
+    static int fix_index(const int& raw,
+                         const size_t& count,
+                         const RelativeIndex& bit,
+                         uint8_t& relative) {
+        if (raw > 0) {
+            return raw - 1;
+        }
+        if (raw == 0) {
+            // parseRawTriple reports a missing index as 0
+            return -1;
+        }
+        relative |= bit;
+        return (int) count + raw;
+    }
+
+    // Fan triangulation, as tinyobj::LoadObj does with `triangulate` set
+    static void add_face(const std::vector<tinyobj::index_t>& face,
+                         const std::vector<uint8_t>& face_relative,
+                         Chunk& chunk) {
+        bool relative = chunk.relative.size() > 0 ||
+                        std::any_of(face_relative.begin(), face_relative.end(),
+                                    [](const uint8_t& bits) {
+                                        return bits != 0;
+                                    });
+        if (relative) {
+            chunk.relative.resize(chunk.indices.size(), 0);
+        }
+
+        for (size_t k = 2; k < face.size(); k++) {
+            chunk.indices.insert(chunk.indices.end(),
+                                 {face[0], face[k - 1], face[k]});
+            if (relative) {
+                chunk.relative.insert(chunk.relative.end(), {
+                    face_relative[0], face_relative[k - 1], face_relative[k]
+                });
+            }
+        }
+    }
+
+    static ObjData merge(const std::vector<Chunk>& chunks) {
+        ObjData data;
+        size_t num_vertices = 0;
+        size_t num_normals = 0;
+        size_t num_texcoords = 0;
+        size_t num_indices = 0;
+        for (const Chunk& chunk : chunks) {
+            num_vertices += chunk.vertices.size();
+            num_normals += chunk.normals.size();
+            num_texcoords += chunk.texcoords.size();
+            num_indices += chunk.indices.size();
+        }
+        data.attrib.vertices.reserve(num_vertices);
+        data.attrib.normals.reserve(num_normals);
+        data.attrib.texcoords.reserve(num_texcoords);
+        data.indices.reserve(num_indices);
+
+        for (const Chunk& chunk : chunks) {
+            int vertex_offset = data.attrib.vertices.size() / 3;
+            int normal_offset = data.attrib.normals.size() / 3;
+            int texcoord_offset = data.attrib.texcoords.size() / 2;
+            size_t index_offset = data.indices.size();
+
+            data.attrib.vertices.insert(data.attrib.vertices.end(),
+                                        chunk.vertices.begin(),
+                                        chunk.vertices.end());
+            data.attrib.normals.insert(data.attrib.normals.end(),
+                                       chunk.normals.begin(),
+                                       chunk.normals.end());
+            data.attrib.texcoords.insert(data.attrib.texcoords.end(),
+                                         chunk.texcoords.begin(),
+                                         chunk.texcoords.end());
+            data.indices.insert(data.indices.end(),
+                                chunk.indices.begin(),
+                                chunk.indices.end());
+
+            for (size_t i = 0; i < chunk.relative.size(); i++) {
+                tinyobj::index_t& idx = data.indices[index_offset + i];
+                if (chunk.relative[i] & RELATIVE_VERTEX) {
+                    idx.vertex_index += vertex_offset;
+                }
+                if (chunk.relative[i] & RELATIVE_NORMAL) {
+                    idx.normal_index += normal_offset;
+                }
+                if (chunk.relative[i] & RELATIVE_TEXCOORD) {
+                    idx.texcoord_index += texcoord_offset;
+                }
+            }
+        }
+        return data;
+    }
+};
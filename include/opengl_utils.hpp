@@ -30,9 +30,12 @@
 #include <unordered_set>
 #include <unordered_map>
 #include <memory>
+#include <limits>
+#include <atomic>
 
 #include <glm/glm.hpp>
 #include <glm/gtx/transform.hpp>
+#include <glm/gtc/packing.hpp>
 
 // OpenGL / glew Headers
 #define GL3_PROTOTYPES 1
@@ -40,7 +43,11 @@
 
 #include "util.hpp"
 #include "gl_context.hpp"
+#include "gl_state.hpp"
 #include "abstract_surface.hpp"
+#include "uniform_block.hpp"
+#include "program_cache.hpp"
+#include "program_reflection.hpp"
 
 // TODO: Update EVERYTHING to use DSA
 // Seriously, OpenGL is not usable without DSA
@@ -52,6 +59,98 @@ typedef struct {
     GLvoid* offset;
 } VertexAttribute;
 
+// One attribute of an interleaved vertex. `type` may be any format
+// accepted by glVertexArrayAttribFormat, e.g. GL_HALF_FLOAT texcoords,
+// GL_INT_2_10_10_10_REV normals or normalized GL_UNSIGNED_BYTE colors.
+typedef struct {
+    GLuint index;
+    GLint size;
+    GLenum type;
+    GLboolean normalized;
+    GLuint offset;
+} VertexFormat;
+
+// Packs a unit vector into a normalized GL_INT_2_10_10_10_REV attribute
+inline GLuint pack_normal(const glm::vec3& normal) {
+    return glm::packSnorm3x10_1x2(glm::vec4(normal, 0.0f));
+}
+
+// Packs two floats into a GL_HALF_FLOAT attribute of size 2
+inline GLuint pack_half2(const glm::vec2& value) {
+    return glm::packHalf2x16(value);
+}
+
+// Packs a [0, 1] color into a normalized GL_UNSIGNED_BYTE attribute of
+// size 4
+inline GLuint pack_color(const glm::vec4& color) {
+    return glm::packUnorm4x8(color);
+}
+
+// Number of channels in a pixel transfer `format`
+inline size_t channel_count(const GLenum& format) {
+    switch (format) {
+    case GL_RG:
+    case GL_RG_INTEGER:
+        return 2;
+    case GL_RGB:
+    case GL_BGR:
+    case GL_RGB_INTEGER:
+    case GL_BGR_INTEGER:
+        return 3;
+    case GL_RGBA:
+    case GL_BGRA:
+    case GL_RGBA_INTEGER:
+    case GL_BGRA_INTEGER:
+        return 4;
+    default:
+        return 1;
+    }
+}
+
+// Size in bytes of one channel of a pixel transfer `type`
+inline size_t component_size(const GLenum& type) {
+    switch (type) {
+    case GL_UNSIGNED_SHORT:
+    case GL_SHORT:
+    case GL_HALF_FLOAT:
+        return 2;
+    case GL_UNSIGNED_INT:
+    case GL_INT:
+    case GL_FLOAT:
+        return 4;
+    default:
+        return 1;
+    }
+}
+
+// Size in bytes of one pixel of `format` and `type`
+inline size_t pixel_size(const GLenum& format, const GLenum& type) {
+    switch (type) {
+    case GL_UNSIGNED_BYTE_3_3_2:
+    case GL_UNSIGNED_BYTE_2_3_3_REV:
+        return 1;
+    case GL_UNSIGNED_SHORT_5_6_5:
+    case GL_UNSIGNED_SHORT_5_6_5_REV:
+    case GL_UNSIGNED_SHORT_4_4_4_4:
+    case GL_UNSIGNED_SHORT_4_4_4_4_REV:
+    case GL_UNSIGNED_SHORT_5_5_5_1:
+    case GL_UNSIGNED_SHORT_1_5_5_5_REV:
+        return 2;
+    case GL_UNSIGNED_INT_8_8_8_8:
+    case GL_UNSIGNED_INT_8_8_8_8_REV:
+    case GL_UNSIGNED_INT_10_10_10_2:
+    case GL_UNSIGNED_INT_2_10_10_10_REV:
+    case GL_UNSIGNED_INT_10F_11F_11F_REV:
+    case GL_UNSIGNED_INT_5_9_9_9_REV:
+    case GL_UNSIGNED_INT_24_8:
+        return 4;
+    case GL_FLOAT_32_UNSIGNED_INT_24_8_REV:
+        return 8;
+    default:
+        return channel_count(format) * component_size(type);
+    }
+}
+
 inline std::ostream& operator<< (std::ostream& out, const glm::bvec2& bvec) {
     out << "bvec2("
         << bvec.x << ", " << bvec.y
@@ -228,6 +327,22 @@ inline std::ostream& operator<< (std::ostream& out, const glm::mat4& mat4) {
     return out;
 }
 
+inline std::ostream& operator<< (std::ostream& out, const VertexFormat& format) {
+    out << "(index: "
+        << format.index
+        << ", size: "
+        << format.size
+        << ", type: "
+        << format.type
+        << ", normalized: "
+        << (int) format.normalized
+        << ", offset: "
+        << format.offset
+        << ")";
+
+    return out;
+}
+
 inline std::ostream& operator<< (std::ostream& out, const VertexAttribute& va) {
     out << "(index: "
         << va.index
@@ -276,15 +391,11 @@ class Buffer {
 
     void bind(const GLenum& target) {
         this->target = target;
-        if (GLContext::add_bound_buffer(target)) {
-            glBindBuffer(target, id);
-        }
+        GLState::bind_buffer(target, id);
     }
 
     void unbind() {
-        if (GLContext::remove_bound_buffer(target)) {
-            glBindBuffer(target, 0);
-        }
+        GLState::unbind_buffer(target, id);
     }
 
     GLuint id;
@@ -293,7 +404,10 @@ class Buffer {
 
 class VAO {
   public:
-    VAO() {
+    VAO() :
+        _index_buffer(0),
+        _num_indices(0),
+        _index_type(GL_UNSIGNED_INT) {
 
     }
 
@@ -304,7 +418,10 @@ class VAO {
         _vertex_buffer(),
         _vertex_attributes(vertex_attributes),
         _primitive_type(primitive_type),
-        _num_vertices(num_vertices) {
+        _num_vertices(num_vertices),
+        _index_buffer(0),
+        _num_indices(0),
+        _index_type(GL_UNSIGNED_INT) {
         glCreateVertexArrays(1, &id);
         for (size_t i = 0; i < vertex_data.size(); i++) {
             Buffer vertex_buffer;
@@ -322,11 +439,90 @@ class VAO {
         create_resources();
     }
 
+    // Indexed geometry, drawn with glDrawElements
+    VAO(const std::vector<GLfloat*>& vertex_data,
+        const std::vector<VertexAttribute>& vertex_attributes,
+        GLuint num_vertices,
+        const std::vector<GLuint>& indices,
+        GLenum primitive_type) :
+        VAO(vertex_data, vertex_attributes, num_vertices, primitive_type) {
+        load_indices(indices);
+    }
+
+    // Interleaved geometry: every attribute in `formats` is read from a
+    // single buffer holding `num_vertices` vertices of `vertex_size` bytes.
+    // Drawn with glDrawElements if `indices` is not empty.
+    VAO(const void* vertex_data,
+        const GLsizei& vertex_size,
+        const std::vector<VertexFormat>& formats,
+        GLuint num_vertices,
+        const std::vector<GLuint>& indices,
+        GLenum primitive_type) :
+        VAO(vertex_data, vertex_size, formats, num_vertices,
+            nullptr, 0, GL_UNSIGNED_INT, primitive_type) {
+        if (!indices.empty()) {
+            load_indices(indices);
+        }
+    }
+
+    // Interleaved geometry whose `num_indices` indices are already stored
+    // as `index_type`, e.g. straight from a mapped MeshFile. Both buffers
+    // get immutable storage.
+    VAO(const void* vertex_data,
+        const GLsizei& vertex_size,
+        const std::vector<VertexFormat>& formats,
+        GLuint num_vertices,
+        const void* index_data,
+        GLuint num_indices,
+        GLenum index_type,
+        GLenum primitive_type) :
+        _vertex_buffer(),
+        _vertex_attributes(),
+        _primitive_type(primitive_type),
+        _num_vertices(num_vertices),
+        _index_buffer(0),
+        _num_indices(0),
+        _index_type(GL_UNSIGNED_INT) {
+        glCreateVertexArrays(1, &id);
+
+        Buffer vertex_buffer;
+        glNamedBufferStorage(vertex_buffer.id,
+                             (GLsizeiptr) num_vertices * vertex_size,
+                             vertex_data,
+                             0);
+        _vertex_buffer.push_back(vertex_buffer);
+        glVertexArrayVertexBuffer(id, 0, vertex_buffer.id, 0, vertex_size);
+
+        std::unordered_set<GLuint> attribute_indices;
+        for (const VertexFormat& format : formats) {
+            if (attribute_indices.count(format.index)) {
+                throw std::runtime_error("Vertex format " + TOS(format) +
+                                         " has an index conflict" +
+                                         " with another vertex format!");
+            }
+            assert(format.offset + format_size(format) <= (GLuint) vertex_size);
+
+            glEnableVertexArrayAttrib(id, format.index);
+            glVertexArrayAttribFormat(id, format.index,
+                                      format.size, format.type,
+                                      format.normalized, format.offset);
+            glVertexArrayAttribBinding(id, format.index, 0);
+            attribute_indices.insert(format.index);
+        }
+
+        if (num_indices > 0) {
+            load_indices(index_data, num_indices, index_type);
+        }
+    }
+
     VAO(const VAO& other) {
         this->_num_vertices = other._num_vertices;
         this->_vertex_buffer = std::vector<Buffer>(other._vertex_buffer);
         this->_primitive_type = other._primitive_type;
         this->_vertex_attributes = other._vertex_attributes;
+        this->_index_buffer = other._index_buffer;
+        this->_num_indices = other._num_indices;
+        this->_index_type = other._index_type;
         this->id = other.id;
     }
 
@@ -336,7 +532,7 @@ class VAO {
 
     void create_resources() {
         std::unordered_set<GLuint> indices;
-        glBindVertexArray(id);
+        GLState::bind_vertex_array(id);
         for (size_t i = 0; i < _vertex_attributes.size(); i++) {
             const VertexAttribute va = _vertex_attributes[i];
 
@@ -350,33 +546,109 @@ class VAO {
             glEnableVertexArrayAttrib(id, va.index);
             _vertex_buffer[i].bind(GL_ARRAY_BUFFER);
             glVertexAttribPointer(
-                i,
+                va.index,
                 va.vector_size,
                 GL_FLOAT,
                 GL_FALSE,
                 va.stride,
                 va.offset
             );
-            _vertex_buffer[i].unbind();
             indices.insert(va.index);
         }
-        glBindVertexArray(0);
+        GLState::bind_vertex_array(0);
     }
 
     bool draw() {
-        glBindVertexArray(id);
-        glDrawArrays(_primitive_type, 0, _num_vertices);
-        glBindVertexArray(0);
+        GLState::bind_vertex_array(id);
+        if (is_indexed()) {
+            glDrawElements(_primitive_type, _num_indices, _index_type, nullptr);
+        } else {
+            glDrawArrays(_primitive_type, 0, _num_vertices);
+        }
 
         return true;
     }
 
+    bool is_indexed() const {
+        return _num_indices > 0;
+    }
+
+    GLuint get_num_vertices() const {
+        return _num_vertices;
+    }
+
+    GLuint get_num_indices() const {
+        return _num_indices;
+    }
+
+    // GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+    GLenum get_index_type() const {
+        return _index_type;
+    }
+
+    // The smallest index type that can address `num_vertices` vertices
+    static GLenum index_type_for(const GLuint& num_vertices) {
+        return num_vertices <= std::numeric_limits<GLushort>::max() + 1u ?
+               GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    }
+
+    // Bytes taken by one attribute described by `format`
+    static GLuint format_size(const VertexFormat& format) {
+        switch (format.type) {
+            case GL_INT_2_10_10_10_REV:
+            case GL_UNSIGNED_INT_2_10_10_10_REV:
+                return 4;
+            case GL_BYTE:
+            case GL_UNSIGNED_BYTE:
+                return format.size;
+            case GL_SHORT:
+            case GL_UNSIGNED_SHORT:
+            case GL_HALF_FLOAT:
+                return format.size * 2;
+            case GL_DOUBLE:
+                return format.size * 8;
+            default:
+                return format.size * 4;
+        }
+    }
+
     GLuint id;
   private:
+    // The indices are stored as 16-bit values when every vertex can be
+    // addressed that way
+    void load_indices(const std::vector<GLuint>& indices) {
+        if (index_type_for(_num_vertices) == GL_UNSIGNED_SHORT) {
+            std::vector<GLushort> short_indices(indices.begin(), indices.end());
+            load_indices(short_indices.data(), indices.size(),
+                         GL_UNSIGNED_SHORT);
+        } else {
+            load_indices(indices.data(), indices.size(), GL_UNSIGNED_INT);
+        }
+    }
+
+    void load_indices(const void* data,
+                      const GLuint& num_indices,
+                      const GLenum& index_type) {
+        _num_indices = num_indices;
+        _index_type = index_type;
+        GLsizeiptr size = (GLsizeiptr) num_indices *
+                          (index_type == GL_UNSIGNED_SHORT ?
+                           sizeof(GLushort) : sizeof(GLuint));
+        glCreateBuffers(1, &_index_buffer);
+        glNamedBufferStorage(_index_buffer, size, data, 0);
+        glVertexArrayElementBuffer(id, _index_buffer);
+    }
+
     std::vector<Buffer> _vertex_buffer;
     std::vector<VertexAttribute> _vertex_attributes;
     GLenum _primitive_type;
     GLuint _num_vertices;
+
+    // Attached to the vertex array with glVertexArrayElementBuffer, so it
+    // is never bound by hand. 0 for non-indexed geometry.
+    GLuint _index_buffer;
+    GLuint _num_indices;
+    GLenum _index_type;
 };
 
 enum TextureParameter {
@@ -457,20 +729,17 @@ class Texture {
               void (*tex_parameter_callback)(void) = NULL) {
         assert(parameters.size() == 0 ^ tex_parameter_callback == NULL);
         if (tex_parameter_callback != NULL) {
-            glBindTexture(_texture_enum, id);
+            // The callback sets parameters on the texture bound to the
+            // active unit
+            GLState::bind_active_texture(0, id);
             tex_parameter_callback();
-            glBindTexture(_texture_enum, 0);
         } else {
-            for (auto parameter : parameters) {
-                apply_parameter(parameter);
-            }
+            set_parameters(parameters);
         }
 
-        glBindTexture(_texture_enum, id);
         glTextureStorage2D(id, this->depth,
                            internalFormat,
                            (GLsizei) width, (GLsizei) height);
-        glBindTexture(_texture_enum, 0);
 
         if (data != NULL) {
             glTextureSubImage2D(id, level,
@@ -491,6 +760,50 @@ class Texture {
         _type = type;
     }
 
+    // Gives level 0 mutable storage of `w` by `h` and fills it with `data`.
+    // Unlike init(), this may be called again to resize the texture, which
+    // lets TextureLoader hand out a placeholder before the image is decoded.
+    void respecify(const GLint& internalFormat,
+                   const GLenum& format,
+                   const GLenum& type,
+                   const GLvoid* data,
+                   const int& w,
+                   const int& h,
+                   const bool& mip_map = true) {
+        // glTexImage2D has no DSA form and acts on the active unit
+        GLState::bind_active_texture(0, id);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTexImage2D(_texture_enum, 0, internalFormat,
+                     (GLsizei) w, (GLsizei) h, 0,
+                     format, type, data);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+        // A previous specification without mipmaps capped the levels
+        if (mip_map) {
+            glTextureParameteri(id, GL_TEXTURE_MAX_LEVEL, MAX_LEVEL_DEFAULT);
+            glTextureParameteri(id, GL_TEXTURE_MAG_FILTER,
+                                GL_LINEAR);
+            glTextureParameteri(id, GL_TEXTURE_MIN_FILTER,
+                                GL_LINEAR_MIPMAP_LINEAR);
+            glGenerateTextureMipmap(id);
+        } else {
+            glTextureParameteri(id, GL_TEXTURE_MAX_LEVEL, 0);
+        }
+
+        this->width = w;
+        this->height = h;
+        this->depth = 1;
+        _internalFormat = internalFormat;
+        this->format = format;
+        _type = type;
+    }
+
+    void set_parameters(const TextureParameterSet& parameters) {
+        for (auto parameter : parameters) {
+            apply_parameter(parameter);
+        }
+    }
+
     void copyTo(Texture& other,
                 const GLint& src_level = 0,
                 const GLint& dst_level = 0,
@@ -536,13 +849,15 @@ class Texture {
         }
     }
 
+    // Binds to a free texture unit, or to unit 0 as the active unit if
+    // `active_texture` is false
     void bind(const bool& active_texture = true) {
         if (active_texture) {
             this->texture_image_unit = GLContext::get_texturing_unit();
-            glBindTextureUnit(texture_image_unit, id);
+            GLState::bind_texture_unit(texture_image_unit, id);
+        } else {
+            GLState::bind_active_texture(0, id);
         }
-
-        glBindTexture(_texture_enum, id);
     }
 
     GLuint id;
@@ -581,28 +896,56 @@ class Texture {
         }
     }
 
+    // GL's initial GL_TEXTURE_MAX_LEVEL
+    constexpr static GLint MAX_LEVEL_DEFAULT = 1000;
+
     GLenum _texture_enum;
 
     GLenum _type;
     GLint _internalFormat;
 };
 
+// Some GLEW versions predate KHR_parallel_shader_compile
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+#define PROGRAM_STATIC_INIT() \
+    std::atomic<uint64_t> Program::link_serials(0);
+
+enum ProgramStatus : uint8_t {
+    PROGRAM_UNLINKED,
+    PROGRAM_LINKING,
+    PROGRAM_LINKED,
+    PROGRAM_FAILED
+};
+
 class Program {
   public:
     Program() :
         shader_ids(new std::vector<GLint>),
-        uniform_cache(new std::unordered_map<std::string, GLint>),
+        shader_sources(new std::vector<ShaderSource>),
         ssbo_binding_map(new std::unordered_map<GLuint, GLuint>),
-        last_ssbo_binding_point(0) {
+        ssbo_block_bindings(new std::unordered_map<std::string, GLuint>),
+        reflection(new ProgramReflection()),
+        globals_version(new uint64_t(0)),
+        link_state(new LinkState({PROGRAM_UNLINKED, 0, 0})),
+        last_ssbo_binding_point(0),
+        link_serial(0) {
         id = glCreateProgram();
     }
 
     Program(const Program& other) {
         this->shader_ids = other.shader_ids;
-        this->uniform_cache = other.uniform_cache;
+        this->shader_sources = other.shader_sources;
         this->ssbo_binding_map = other.ssbo_binding_map;
+        this->ssbo_block_bindings = other.ssbo_block_bindings;
+        this->reflection = other.reflection;
+        this->globals_version = other.globals_version;
+        this->link_state = other.link_state;
         this->last_ssbo_binding_point = other.last_ssbo_binding_point;
         this->id = other.id;
+        this->link_serial = other.link_serial;
     }
 
     ~Program() {
@@ -615,28 +958,310 @@ class Program {
         return (this->id == other.id);
     }
 
+    // Reads a shader stage into the program and compiles it. With the
+    // ProgramCache enabled compilation is left to link_program, which can
+    // skip it entirely when a cached binary exists, and errors are reported
+    // there instead.
     std::string compile_shader(const std::string& filename_or_str,
                                GLenum shader_type,
                                const bool& is_filename = true,
                                const bool& error_log = false) {
-        GLuint shader = glCreateShader(shader_type);
+        add_shader(filename_or_str, shader_type, is_filename);
+        if (ProgramCache::enabled()) {
+            return std::string();
+        }
 
-        const GLchar* source;
-        std::string source_str;
+        link_state->num_submitted = shader_sources->size();
+        return compile_source(shader_sources->back(), error_log);
+    }
 
+    // Reads a shader stage into the program without compiling it, so that
+    // link_program or link_program_async can submit every stage together
+    void add_shader(const std::string& filename_or_str,
+                    GLenum shader_type,
+                    const bool& is_filename = true) {
+        ShaderSource source;
+        source.type = shader_type;
         if (is_filename) {
-            std::ifstream t(filename_or_str);
-            source_str = std::string((std::istreambuf_iterator<char>(t)),
-                                     std::istreambuf_iterator<char>());
-            source = (const GLchar*) source_str.c_str();
+            source.source = read_file(filename_or_str);
+            source.filename = filename_or_str;
         } else {
-            source = filename_or_str.c_str();
+            source.source = filename_or_str;
         }
+        this->shader_sources->push_back(source);
+    }
 
-        glShaderSource(shader, 1, &source, 0);
+    // Compiles a shader and attaches it to the program, returning the info
+    // log if it failed
+    std::string compile_source(const ShaderSource& source_info,
+                               const bool& error_log = false) {
+        GLuint shader = submit_shader(source_info);
+        std::string log = shader_log(shader, source_info.filename);
+        if (!log.empty()) {
+            glDetachShader(id, shader);
+            glDeleteShader(shader);
+            shader_ids->pop_back();
+
+            if (error_log) {
+                ERROR(log);
+            }
+        }
+
+        return log;
+    }
+
+    bool link_program() {
+        return submit_link(true) && finish_link();
+    }
+
+    // Starts compiling and linking every stage that has not been compiled
+    // yet without waiting for the driver. Errors are reported by the
+    // poll_link() that finds the link finished. With the ProgramCache
+    // enabled a cached binary is loaded immediately instead.
+    bool link_program_async() {
+        return submit_link(false);
+    }
+
+    // Finishes an asynchronous link if the driver is done with it. Drivers
+    // without KHR_parallel_shader_compile cannot be asked, so there the
+    // first poll waits; submitting every program before polling any of them
+    // still lets such a driver overlap the work.
+    bool poll_link() {
+        if (link_state->status == PROGRAM_LINKING) {
+            GLint done = GL_TRUE;
+            if (GLContext::parallel_shader_compile) {
+                glGetProgramiv(id, GL_COMPLETION_STATUS_KHR, &done);
+            }
+            if (done == GL_TRUE) {
+                finish_link();
+            }
+        }
+        return link_state->status == PROGRAM_LINKED;
+    }
+
+    bool is_linked() const {
+        return link_state->status == PROGRAM_LINKED;
+    }
+
+    ProgramStatus get_link_status() const {
+        return link_state->status;
+    }
+
+    // This program once it has linked, and `fallback` until then
+    Program& ready_or(Program& fallback) {
+        return poll_link() ? *this : fallback;
+    }
+
+    // Starts linking every program before waiting on any of them, so that
+    // a driver with compiler threads works on all of them at once. Each
+    // Program is its own handle afterwards (poll_link, ready_or).
+    static void link_all_async(const std::vector<Program*>& programs) {
+        for (Program* program : programs) {
+            program->link_program_async();
+        }
+    }
+
+    // Polls every program, returning true once none is still linking
+    static bool poll_all(const std::vector<Program*>& programs) {
+        bool done = true;
+        for (Program* program : programs) {
+            program->poll_link();
+            done = done && program->get_link_status() != PROGRAM_LINKING;
+        }
+        return done;
+    }
+
+    const std::vector<ShaderSource>& get_shader_sources() const {
+        return *shader_sources;
+    }
+
+    // Takes over the GL program of `fresh`, which must have linked, and
+    // gives `fresh` this one's in exchange. Uniform values, uniform block
+    // bindings and SSBO block bindings carry over to the new program where
+    // it still has them. Commands holding a reference to this Program draw
+    // with the new program from then on.
+    void replace(Program& fresh) {
+        assert(fresh.is_linked());
 
+        copy_uniforms(id, fresh.id);
+        for (const UniformBlockLayout& block : reflection->uniform_blocks) {
+            fresh.bind_uniform_block(block.name, block.binding, false);
+        }
+        for (auto& ssbo : *ssbo_block_bindings) {
+            GLuint block_index =
+                glGetProgramResourceIndex(fresh.id, GL_SHADER_STORAGE_BLOCK,
+                                          ssbo.first.c_str());
+            if (block_index != GL_INVALID_INDEX) {
+                glShaderStorageBlockBinding(fresh.id, block_index,
+                                            ssbo.second);
+            }
+        }
+
+        std::swap(id, fresh.id);
+        std::swap(link_serial, fresh.link_serial);
+        shader_ids->swap(*fresh.shader_ids);
+        shader_sources->swap(*fresh.shader_sources);
+        std::swap(*reflection, *fresh.reflection);
+        std::swap(*link_state, *fresh.link_state);
+
+        // Global uniforms have to be applied to the new program again
+        *globals_version = 0;
+    }
+
+    void bind() {
+        GLState::use_program(this->id);
+    }
+
+
+    void attach_ssbo(Buffer& buffer,
+                     const std::string& buffer_name) {
+        const ProgramResource* block =
+            ProgramReflection::find(reflection->storage_blocks,
+                                    intern_name(buffer_name));
+        if (block == nullptr) {
+            ERROR("Could not find shader storage block " << buffer_name <<
+                  "!");
+            return;
+        }
+        GLuint block_index = block->index;
+
+        (*ssbo_binding_map)[buffer.id] = last_ssbo_binding_point++;
+        (*ssbo_block_bindings)[buffer_name] = ssbo_binding_map->at(buffer.id);
+
+        // Cache stuff so that this gets more efficient
+        glShaderStorageBlockBinding(id,
+                                    block_index,
+                                    ssbo_binding_map->at(buffer.id));
+        GLState::bind_buffer_base(GL_SHADER_STORAGE_BUFFER,
+                                  ssbo_binding_map->at(buffer.id),
+                                  buffer.id);
+    }
+
+    void remove_ssbo(Buffer& buffer) {
+        GLState::bind_buffer_base(GL_SHADER_STORAGE_BUFFER,
+                                  ssbo_binding_map->at(buffer.id),
+                                  0);
+    }
+
+    // Layout of an active uniform block, or nullptr if the program has no
+    // block called `block_name`
+    const UniformBlockLayout* get_uniform_block(
+        const std::string& block_name) const {
+        for (const UniformBlockLayout& block : reflection->uniform_blocks) {
+            if (block.name == block_name)
+                return &block;
+        }
+        return nullptr;
+    }
+
+    bool bind_uniform_block(const std::string& block_name,
+                            const GLuint& binding,
+                            const bool& validate = true) {
+        for (UniformBlockLayout& block : reflection->uniform_blocks) {
+            if (block.name == block_name) {
+                glUniformBlockBinding(id, block.index, binding);
+                block.binding = binding;
+                return true;
+            }
+        }
+        if (validate) {
+            ERROR("Could not find uniform block " << block_name << "!");
+            exit(1);
+        }
+        return false;
+    }
+
+    // Version of DrawCommand's global uniform table last applied to this
+    // program
+    uint64_t get_globals_version() const {
+        return *globals_version;
+    }
+
+    void set_globals_version(const uint64_t& version) {
+        *globals_version = version;
+    }
+
+    void dispatch_compute(const glm::uvec3& workgroup_count) {
+        glDispatchCompute(workgroup_count.x,
+                          workgroup_count.y,
+                          workgroup_count.z);
+    }
+
+    // Everything the program exposes, as of its last link
+    const ProgramReflection& get_reflection() const {
+        return *reflection;
+    }
+
+    // Looks a uniform up once so that it can be set without a name lookup.
+    // Handles stay usable across a relink.
+    UniformHandle get_uniform_handle(const UniformName& name,
+                                     const bool& validate = true) const {
+        UniformHandle handle = reflection->uniform_handle(name.id);
+        if (handle.index == -1 && validate) {
+            ERROR("Could not find uniform " << name << "!");
+        }
+        return handle;
+    }
+
+    // A missing uniform is reported when `validate` is set and otherwise
+    // ignored; setting location -1 is a no-op in GL
+    GLint get_uniform_location(const UniformName& name,
+                               const bool& validate = true) {
+        const ProgramResource* uniform =
+            ProgramReflection::find(reflection->uniforms, name.id);
+        GLint location = uniform != nullptr ? uniform->location : -1;
+
+        if (location == -1 && validate) {
+            ERROR("Could not find uniform " << name << "!");
+        }
+        return location;
+    }
+
+    template <typename T>
+    void set_uniform(const UniformName& name,
+                     T value,
+                     const bool& validate = true) {
+        _set_uniform(get_uniform_location(name, validate), value);
+    }
+
+    template <typename T>
+    void set_uniform(const UniformHandle& handle, T value) {
+        _set_uniform(reflection->location(handle), value);
+    }
+
+    // Identifies one link of one GL program. It changes whenever the
+    // program is linked or replaced, unlike the GL name, which the driver
+    // may hand out again once a replaced program is deleted. 0 until the
+    // first link.
+    uint64_t get_link_serial() const {
+        return link_serial;
+    }
+
+    GLuint id;
+  private:
+    typedef struct {
+        ProgramStatus status;
+        // Number of shader_sources already compiled
+        size_t num_submitted;
+        uint64_t cache_key;
+    } LinkState;
+
+    GLuint submit_shader(const ShaderSource& source_info) {
+        GLuint shader = glCreateShader(source_info.type);
+
+        const GLchar* source = (const GLchar*) source_info.source.c_str();
+        glShaderSource(shader, 1, &source, 0);
         glCompileShader(shader);
 
+        this->shader_ids->push_back(shader);
+        glAttachShader(id, shader);
+
+        return shader;
+    }
+
+    // Empty if the shader compiled; querying this waits for the compile
+    std::string shader_log(const GLuint& shader,
+                           const std::string& filename) {
         GLint isCompiled = 0;
         glGetShaderiv(shader, GL_COMPILE_STATUS, &isCompiled);
         std::string log;
@@ -647,37 +1272,69 @@ class Program {
             std::vector<GLchar> info_log(maxLength);
             glGetShaderInfoLog(shader, maxLength, &maxLength, &info_log[0]);
 
-            glDeleteShader(shader);
-
-            if (is_filename) {
-                log = "Failed to compile shader " + filename_or_str
+            if (!filename.empty()) {
+                log = "Failed to compile shader " + filename
                       + "! Info log:\n\n";
             } else {
                 log = "Failed to compile shader! Info log:\n\n";
             }
             for (auto& a : info_log)
                 log += a;
+        }
+        return log;
+    }
 
-            if (error_log) {
-                ERROR(log);
+    bool submit_link(const bool& check_shaders) {
+        if (ProgramCache::enabled()) {
+            link_state->cache_key =
+                ProgramCache::key(*shader_sources,
+                                  ProgramCache::driver_string());
+            if (ProgramCache::load(id, link_state->cache_key)) {
+                link_state->num_submitted = shader_sources->size();
+                link_state->status = PROGRAM_LINKED;
+                on_link();
+                return true;
             }
-
-            return log;
         }
 
-        this->shader_ids->push_back(shader);
-
-        glAttachShader(id, shader);
+        for (size_t i = link_state->num_submitted;
+                i < shader_sources->size(); i++) {
+            const ShaderSource& source = (*shader_sources)[i];
+            if (!check_shaders) {
+                submit_shader(source);
+            } else if (!compile_source(source, true).empty()) {
+                link_state->status = PROGRAM_FAILED;
+                return false;
+            }
+        }
+        link_state->num_submitted = shader_sources->size();
 
-        return log;
+        if (ProgramCache::enabled()) {
+            glProgramParameteri(id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT,
+                                GL_TRUE);
+        }
+        glLinkProgram(id);
+        link_state->status = PROGRAM_LINKING;
+        return true;
     }
 
-    bool link_program() {
-        glLinkProgram(id);
+    bool finish_link() {
+        if (link_state->status != PROGRAM_LINKING) {
+            return link_state->status == PROGRAM_LINKED;
+        }
 
         GLint isLinked = 0;
         glGetProgramiv(id, GL_LINK_STATUS, (int*)&isLinked);
         if (isLinked == GL_FALSE) {
+            // Shaders submitted without being checked report their errors
+            // here
+            for (auto& shader : *shader_ids) {
+                std::string log = shader_log(shader, std::string());
+                if (!log.empty()) {
+                    ERROR(log);
+                }
+            }
+
             GLint maxLength = 0;
             glGetProgramiv(id, GL_INFO_LOG_LENGTH, &maxLength);
 
@@ -688,71 +1345,320 @@ class Program {
             for (auto& a : info_log)
                 std::cout << a;
 
+            link_state->status = PROGRAM_FAILED;
             return false;
         }
 
         for (auto& shader : *shader_ids)
             glDetachShader(id, shader);
 
-        return true;
-    }
+        if (ProgramCache::enabled()) {
+            ProgramCache::store(id, link_state->cache_key);
+        }
+        link_state->status = PROGRAM_LINKED;
+        on_link();
 
-    void bind() {
-        glUseProgram(this->id);
+        return true;
     }
 
+    // Copies the value of every default block uniform of `from` that `to`
+    // also has with the same type
+    static void copy_uniforms(const GLuint& from, const GLuint& to) {
+        GLint num_uniforms = 0;
+        glGetProgramInterfaceiv(from, GL_UNIFORM, GL_ACTIVE_RESOURCES,
+                                &num_uniforms);
+
+        GLint max_name_length = 0;
+        glGetProgramInterfaceiv(from, GL_UNIFORM, GL_MAX_NAME_LENGTH,
+                                &max_name_length);
+
+        const GLenum properties[] = {
+            GL_TYPE, GL_LOCATION, GL_ARRAY_SIZE
+        };
+        std::vector<GLchar> name(std::max(max_name_length, 1));
+        for (GLint i = 0; i < num_uniforms; i++) {
+            GLint from_values[3];
+            glGetProgramResourceiv(from, GL_UNIFORM, i, 3, properties, 3,
+                                   nullptr, from_values);
+            // Members of uniform blocks have no location
+            if (from_values[1] == -1) {
+                continue;
+            }
 
-    void attach_ssbo(Buffer& buffer,
-                     const std::string& buffer_name) {
-        GLuint block_index = 0;
-        block_index = glGetProgramResourceIndex(id,
-                                                GL_SHADER_STORAGE_BLOCK,
-                                                buffer_name.c_str());
+            glGetProgramResourceName(from, GL_UNIFORM, i,
+                                     (GLsizei) name.size(), nullptr,
+                                     name.data());
+            GLuint to_index = glGetProgramResourceIndex(to, GL_UNIFORM,
+                                                        name.data());
+            if (to_index == GL_INVALID_INDEX) {
+                continue;
+            }
 
-        (*ssbo_binding_map)[buffer.id] = last_ssbo_binding_point++;
+            GLint to_values[3];
+            glGetProgramResourceiv(to, GL_UNIFORM, to_index, 3, properties,
+                                   3, nullptr, to_values);
+            if (to_values[0] != from_values[0] || to_values[1] == -1) {
+                continue;
+            }
 
-        // Cache stuff so that this gets more efficient
-        glShaderStorageBlockBinding(id,
-                                    block_index,
-                                    ssbo_binding_map->at(buffer.id));
-        glBindBufferBase(GL_SHADER_STORAGE_BUFFER,
-                         ssbo_binding_map->at(buffer.id),
-                         buffer.id);
+            GLint count = std::min(from_values[2], to_values[2]);
+            for (GLint element = 0; element < count; element++) {
+                copy_uniform(from, from_values[1] + element,
+                             to, to_values[1] + element,
+                             (GLenum) from_values[0]);
+            }
+        }
     }
 
-    void remove_ssbo(Buffer& buffer) {
-        glBindBufferBase(GL_SHADER_STORAGE_BUFFER,
-                         ssbo_binding_map->at(buffer.id),
-                         0);
+    static void copy_uniform(const GLuint& from,
+                             const GLint& from_location,
+                             const GLuint& to,
+                             const GLint& to_location,
+                             const GLenum& type) {
+        GLfloat f[16];
+        GLdouble d[16];
+        GLint i[4];
+        GLuint u[4];
+        switch (type) {
+            case GL_FLOAT:
+                glGetUniformfv(from, from_location, f);
+                glProgramUniform1fv(to, to_location, 1, f);
+                break;
+            case GL_FLOAT_VEC2:
+                glGetUniformfv(from, from_location, f);
+                glProgramUniform2fv(to, to_location, 1, f);
+                break;
+            case GL_FLOAT_VEC3:
+                glGetUniformfv(from, from_location, f);
+                glProgramUniform3fv(to, to_location, 1, f);
+                break;
+            case GL_FLOAT_VEC4:
+                glGetUniformfv(from, from_location, f);
+                glProgramUniform4fv(to, to_location, 1, f);
+                break;
+            case GL_FLOAT_MAT2:
+                glGetUniformfv(from, from_location, f);
+                glProgramUniformMatrix2fv(to, to_location, 1, GL_FALSE, f);
+                break;
+            case GL_FLOAT_MAT3:
+                glGetUniformfv(from, from_location, f);
+                glProgramUniformMatrix3fv(to, to_location, 1, GL_FALSE, f);
+                break;
+            case GL_FLOAT_MAT4:
+                glGetUniformfv(from, from_location, f);
+                glProgramUniformMatrix4fv(to, to_location, 1, GL_FALSE, f);
+                break;
+            case GL_FLOAT_MAT2x3:
+                glGetUniformfv(from, from_location, f);
+                glProgramUniformMatrix2x3fv(to, to_location, 1, GL_FALSE, f);
+                break;
+            case GL_FLOAT_MAT2x4:
+                glGetUniformfv(from, from_location, f);
+                glProgramUniformMatrix2x4fv(to, to_location, 1, GL_FALSE, f);
+                break;
+            case GL_FLOAT_MAT3x2:
+                glGetUniformfv(from, from_location, f);
+                glProgramUniformMatrix3x2fv(to, to_location, 1, GL_FALSE, f);
+                break;
+            case GL_FLOAT_MAT3x4:
+                glGetUniformfv(from, from_location, f);
+                glProgramUniformMatrix3x4fv(to, to_location, 1, GL_FALSE, f);
+                break;
+            case GL_FLOAT_MAT4x2:
+                glGetUniformfv(from, from_location, f);
+                glProgramUniformMatrix4x2fv(to, to_location, 1, GL_FALSE, f);
+                break;
+            case GL_FLOAT_MAT4x3:
+                glGetUniformfv(from, from_location, f);
+                glProgramUniformMatrix4x3fv(to, to_location, 1, GL_FALSE, f);
+                break;
+            case GL_DOUBLE:
+                glGetUniformdv(from, from_location, d);
+                glProgramUniform1dv(to, to_location, 1, d);
+                break;
+            case GL_DOUBLE_VEC2:
+                glGetUniformdv(from, from_location, d);
+                glProgramUniform2dv(to, to_location, 1, d);
+                break;
+            case GL_DOUBLE_VEC3:
+                glGetUniformdv(from, from_location, d);
+                glProgramUniform3dv(to, to_location, 1, d);
+                break;
+            case GL_DOUBLE_VEC4:
+                glGetUniformdv(from, from_location, d);
+                glProgramUniform4dv(to, to_location, 1, d);
+                break;
+            case GL_DOUBLE_MAT2:
+                glGetUniformdv(from, from_location, d);
+                glProgramUniformMatrix2dv(to, to_location, 1, GL_FALSE, d);
+                break;
+            case GL_DOUBLE_MAT3:
+                glGetUniformdv(from, from_location, d);
+                glProgramUniformMatrix3dv(to, to_location, 1, GL_FALSE, d);
+                break;
+            case GL_DOUBLE_MAT4:
+                glGetUniformdv(from, from_location, d);
+                glProgramUniformMatrix4dv(to, to_location, 1, GL_FALSE, d);
+                break;
+            case GL_DOUBLE_MAT2x3:
+                glGetUniformdv(from, from_location, d);
+                glProgramUniformMatrix2x3dv(to, to_location, 1, GL_FALSE, d);
+                break;
+            case GL_DOUBLE_MAT2x4:
+                glGetUniformdv(from, from_location, d);
+                glProgramUniformMatrix2x4dv(to, to_location, 1, GL_FALSE, d);
+                break;
+            case GL_DOUBLE_MAT3x2:
+                glGetUniformdv(from, from_location, d);
+                glProgramUniformMatrix3x2dv(to, to_location, 1, GL_FALSE, d);
+                break;
+            case GL_DOUBLE_MAT3x4:
+                glGetUniformdv(from, from_location, d);
+                glProgramUniformMatrix3x4dv(to, to_location, 1, GL_FALSE, d);
+                break;
+            case GL_DOUBLE_MAT4x2:
+                glGetUniformdv(from, from_location, d);
+                glProgramUniformMatrix4x2dv(to, to_location, 1, GL_FALSE, d);
+                break;
+            case GL_DOUBLE_MAT4x3:
+                glGetUniformdv(from, from_location, d);
+                glProgramUniformMatrix4x3dv(to, to_location, 1, GL_FALSE, d);
+                break;
+            case GL_INT:
+            case GL_BOOL:
+                glGetUniformiv(from, from_location, i);
+                glProgramUniform1iv(to, to_location, 1, i);
+                break;
+            case GL_INT_VEC2:
+            case GL_BOOL_VEC2:
+                glGetUniformiv(from, from_location, i);
+                glProgramUniform2iv(to, to_location, 1, i);
+                break;
+            case GL_INT_VEC3:
+            case GL_BOOL_VEC3:
+                glGetUniformiv(from, from_location, i);
+                glProgramUniform3iv(to, to_location, 1, i);
+                break;
+            case GL_INT_VEC4:
+            case GL_BOOL_VEC4:
+                glGetUniformiv(from, from_location, i);
+                glProgramUniform4iv(to, to_location, 1, i);
+                break;
+            case GL_UNSIGNED_INT:
+                glGetUniformuiv(from, from_location, u);
+                glProgramUniform1uiv(to, to_location, 1, u);
+                break;
+            case GL_UNSIGNED_INT_VEC2:
+                glGetUniformuiv(from, from_location, u);
+                glProgramUniform2uiv(to, to_location, 1, u);
+                break;
+            case GL_UNSIGNED_INT_VEC3:
+                glGetUniformuiv(from, from_location, u);
+                glProgramUniform3uiv(to, to_location, 1, u);
+                break;
+            case GL_UNSIGNED_INT_VEC4:
+                glGetUniformuiv(from, from_location, u);
+                glProgramUniform4uiv(to, to_location, 1, u);
+                break;
+            default:
+                // The value of a sampler or image is the unit it reads from
+                if (is_opaque_type(type)) {
+                    glGetUniformiv(from, from_location, i);
+                    glProgramUniform1iv(to, to_location, 1, i);
+                } else {
+                    DEBUG("Not copying uniform of unknown type " << type);
+                }
+                break;
+        }
     }
 
-    void dispatch_compute(const glm::uvec3& workgroup_count) {
-        glDispatchCompute(workgroup_count.x,
-                          workgroup_count.y,
-                          workgroup_count.z);
+    static bool is_opaque_type(const GLenum& type) {
+        switch (type) {
+            case GL_SAMPLER_1D:
+            case GL_SAMPLER_2D:
+            case GL_SAMPLER_3D:
+            case GL_SAMPLER_CUBE:
+            case GL_SAMPLER_1D_SHADOW:
+            case GL_SAMPLER_2D_SHADOW:
+            case GL_SAMPLER_1D_ARRAY:
+            case GL_SAMPLER_2D_ARRAY:
+            case GL_SAMPLER_1D_ARRAY_SHADOW:
+            case GL_SAMPLER_2D_ARRAY_SHADOW:
+            case GL_SAMPLER_2D_MULTISAMPLE:
+            case GL_SAMPLER_2D_MULTISAMPLE_ARRAY:
+            case GL_SAMPLER_CUBE_SHADOW:
+            case GL_SAMPLER_BUFFER:
+            case GL_SAMPLER_2D_RECT:
+            case GL_SAMPLER_2D_RECT_SHADOW:
+            case GL_SAMPLER_CUBE_MAP_ARRAY:
+            case GL_SAMPLER_CUBE_MAP_ARRAY_SHADOW:
+            case GL_INT_SAMPLER_1D:
+            case GL_INT_SAMPLER_2D:
+            case GL_INT_SAMPLER_3D:
+            case GL_INT_SAMPLER_CUBE:
+            case GL_INT_SAMPLER_1D_ARRAY:
+            case GL_INT_SAMPLER_2D_ARRAY:
+            case GL_INT_SAMPLER_2D_MULTISAMPLE:
+            case GL_INT_SAMPLER_2D_MULTISAMPLE_ARRAY:
+            case GL_INT_SAMPLER_BUFFER:
+            case GL_INT_SAMPLER_2D_RECT:
+            case GL_INT_SAMPLER_CUBE_MAP_ARRAY:
+            case GL_UNSIGNED_INT_SAMPLER_1D:
+            case GL_UNSIGNED_INT_SAMPLER_2D:
+            case GL_UNSIGNED_INT_SAMPLER_3D:
+            case GL_UNSIGNED_INT_SAMPLER_CUBE:
+            case GL_UNSIGNED_INT_SAMPLER_1D_ARRAY:
+            case GL_UNSIGNED_INT_SAMPLER_2D_ARRAY:
+            case GL_UNSIGNED_INT_SAMPLER_2D_MULTISAMPLE:
+            case GL_UNSIGNED_INT_SAMPLER_2D_MULTISAMPLE_ARRAY:
+            case GL_UNSIGNED_INT_SAMPLER_BUFFER:
+            case GL_UNSIGNED_INT_SAMPLER_2D_RECT:
+            case GL_UNSIGNED_INT_SAMPLER_CUBE_MAP_ARRAY:
+            case GL_IMAGE_1D:
+            case GL_IMAGE_2D:
+            case GL_IMAGE_3D:
+            case GL_IMAGE_2D_RECT:
+            case GL_IMAGE_CUBE:
+            case GL_IMAGE_BUFFER:
+            case GL_IMAGE_1D_ARRAY:
+            case GL_IMAGE_2D_ARRAY:
+            case GL_IMAGE_CUBE_MAP_ARRAY:
+            case GL_IMAGE_2D_MULTISAMPLE:
+            case GL_IMAGE_2D_MULTISAMPLE_ARRAY:
+            case GL_INT_IMAGE_1D:
+            case GL_INT_IMAGE_2D:
+            case GL_INT_IMAGE_3D:
+            case GL_INT_IMAGE_2D_RECT:
+            case GL_INT_IMAGE_CUBE:
+            case GL_INT_IMAGE_BUFFER:
+            case GL_INT_IMAGE_1D_ARRAY:
+            case GL_INT_IMAGE_2D_ARRAY:
+            case GL_INT_IMAGE_CUBE_MAP_ARRAY:
+            case GL_INT_IMAGE_2D_MULTISAMPLE:
+            case GL_INT_IMAGE_2D_MULTISAMPLE_ARRAY:
+            case GL_UNSIGNED_INT_IMAGE_1D:
+            case GL_UNSIGNED_INT_IMAGE_2D:
+            case GL_UNSIGNED_INT_IMAGE_3D:
+            case GL_UNSIGNED_INT_IMAGE_2D_RECT:
+            case GL_UNSIGNED_INT_IMAGE_CUBE:
+            case GL_UNSIGNED_INT_IMAGE_BUFFER:
+            case GL_UNSIGNED_INT_IMAGE_1D_ARRAY:
+            case GL_UNSIGNED_INT_IMAGE_2D_ARRAY:
+            case GL_UNSIGNED_INT_IMAGE_CUBE_MAP_ARRAY:
+            case GL_UNSIGNED_INT_IMAGE_2D_MULTISAMPLE:
+            case GL_UNSIGNED_INT_IMAGE_2D_MULTISAMPLE_ARRAY:
+                return true;
+            default:
+                return false;
+        }
     }
 
-    template <typename T>
-    void set_uniform(const std::string& name,
-                     T value,
-                     const bool& validate = true) {
-        GLint location;
-        if (uniform_cache->count(name))
-            location = uniform_cache->at(name);
-        else {
-            location = glGetUniformLocation(id, name.c_str());
-            (*uniform_cache)[name] = location;
-        }
-        if (location == -1 && validate) {
-            ERROR("Could not find uniform " << name << "!" <<
-                  " Error: " << glGetError());
-            exit(1);
-        }
-        _set_uniform(location, value);
+    void on_link() {
+        link_serial = ++link_serials;
+        *reflection = ProgramReflection::reflect(id);
+        bind_uniform_block(FRAME_BLOCK_NAME, FRAME_BLOCK_BINDING, false);
     }
 
-    GLuint id;
-  private:
     template <typename T>
     void _set_uniform(const GLint& location, T value) {
         ERROR("Don't know what to do with a uniform like " <<
@@ -816,9 +1722,18 @@ class Program {
     }
 
     std::shared_ptr<std::vector<GLint>> shader_ids;
-    std::shared_ptr<std::unordered_map<std::string, GLint>> uniform_cache;
+    std::shared_ptr<std::vector<ShaderSource>> shader_sources;
     std::shared_ptr<std::unordered_map<GLuint, GLuint>> ssbo_binding_map;
+    // SSBO binding point of each block attached by name
+    std::shared_ptr<std::unordered_map<std::string, GLuint>>
+    ssbo_block_bindings;
+    std::shared_ptr<ProgramReflection> reflection;
+    std::shared_ptr<uint64_t> globals_version;
+    std::shared_ptr<LinkState> link_state;
     int last_ssbo_binding_point;
+    uint64_t link_serial;
+
+    static std::atomic<uint64_t> link_serials;
 };
 
 class Framebuffer : public AbstractSurface {
@@ -835,8 +1750,8 @@ class Framebuffer : public AbstractSurface {
                          const GLenum& format = GL_RGBA,
                          const GLenum& internal_format = GL_RGBA32F,
                          const GLenum& type = GL_UNSIGNED_BYTE) :
-        textures(),
-        draw_buffers(),
+        textures(new std::unordered_map<GLenum, Texture>),
+        draw_buffers(new std::unordered_map<std::string, GLenum>),
         width(w),
         height(h) {
         glCreateFramebuffers(1, &id);
@@ -930,18 +1845,28 @@ class Framebuffer : public AbstractSurface {
         return this->height;
     }
 
+    virtual GLuint get_framebuffer_id() const override {
+        return this->id;
+    }
+
+    virtual GLenum get_read_buffer() const override {
+        return GL_COLOR_ATTACHMENT0;
+    }
+
     virtual void on_resize(const int& width, const int& height) override {
         this->width = width;
         this->height = height;
     }
 
     virtual void bind() override {
-        glBindFramebuffer(GL_FRAMEBUFFER, id);
-        glViewport(0, 0, width, height);
+        GLState::bind_framebuffer(GL_FRAMEBUFFER, id);
+        if (width > 0 && height > 0) {
+            GLState::viewport(0, 0, width, height);
+        }
     }
 
     virtual void unbind() override {
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        GLState::bind_framebuffer(GL_FRAMEBUFFER, 0);
     }
 
     void validate() {
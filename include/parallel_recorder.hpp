@@ -0,0 +1,209 @@
+//
+// ChameleonGL - A small framework for OpenGL.
+// Copyright (C) 2012-2017 Srinivas Kaza
+//
+// This file is part of ChameleonGL.
+//
+// ChameleonGL is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ChameleonGL is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ChameleonGL.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <exception>
+
+#include "command.hpp"
+#include "frame_arena.hpp"
+#include "frame_command_list.hpp"
+
+// Records a frame's commands on several threads at once. Each job gets its
+// own FrameCommandList backed by its own FrameArena, and the buffers are
+// appended to the output in job order, so the merged list does not depend
+// on which thread ran which job.
+//
+// Jobs must not make GL calls; they only construct commands. Everything a
+// job touches besides its own buffer must be safe to read concurrently.
+class ParallelRecorder {
+  public:
+    typedef std::function<void(size_t, FrameCommandList&)> Job;
+
+    explicit ParallelRecorder(
+        const size_t& num_threads = std::thread::hardware_concurrency()) :
+        _buffers(),
+        _workers(),
+        _job(nullptr),
+        _num_jobs(0),
+        _next_job(0),
+        _pending(0),
+        _active(0),
+        _generation(0),
+        _stop(false),
+        _error() {
+        // The calling thread also runs jobs, so it counts as one worker
+        for (size_t i = 1; i < num_threads; i++) {
+            _workers.push_back(std::thread(&ParallelRecorder::worker_loop,
+                                           this));
+        }
+    }
+
+    ParallelRecorder(const ParallelRecorder& other) = delete;
+    ParallelRecorder& operator=(const ParallelRecorder& other) = delete;
+
+    ~ParallelRecorder() {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _stop = true;
+        }
+        _wake.notify_all();
+        for (std::thread& worker : _workers) {
+            worker.join();
+        }
+    }
+
+    // Runs job(i, buffer) for every i in [0, num_jobs) and appends the
+    // buffers to `out` in order of i. The buffers from the previous call are
+    // recycled here, so the commands they held must have been released.
+    void record(const size_t& num_jobs,
+                const Job& job,
+                FrameCommandList& out) {
+        {
+            // Workers that woke up late for the previous call must be gone
+            // before the buffers and job counters are touched
+            std::unique_lock<std::mutex> lock(_mutex);
+            _done.wait(lock, [this]() {
+                return _active == 0;
+            });
+
+            while (_buffers.size() < num_jobs) {
+                _buffers.push_back(std::unique_ptr<Buffer>(new Buffer()));
+            }
+            for (auto& buffer : _buffers) {
+                buffer->commands.clear();
+                buffer->arena.reset();
+            }
+
+            _job = &job;
+            _num_jobs = num_jobs;
+            _next_job = 0;
+            _pending = num_jobs;
+            _error = nullptr;
+            _generation++;
+        }
+        _wake.notify_all();
+
+        run_jobs();
+
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _done.wait(lock, [this]() {
+                return _pending == 0 && _active == 0;
+            });
+            _job = nullptr;
+        }
+
+        if (_error) {
+            std::rethrow_exception(_error);
+        }
+
+        for (size_t i = 0; i < num_jobs; i++) {
+            out.append(_buffers[i]->commands.commands());
+        }
+    }
+
+    size_t num_threads() const {
+        return _workers.size() + 1;
+    }
+
+  private:
+    typedef struct Buffer {
+        Buffer() :
+            arena(),
+            commands(arena) {
+        }
+
+        FrameArena arena;
+        FrameCommandList commands;
+    } Buffer;
+
+    void worker_loop() {
+        size_t seen = 0;
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _wake.wait(lock, [this, &seen]() {
+                    return _stop || _generation != seen;
+                });
+                if (_stop) {
+                    return;
+                }
+                seen = _generation;
+                _active++;
+            }
+
+            run_jobs();
+
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _active--;
+            }
+            _done.notify_all();
+        }
+    }
+
+    void run_jobs() {
+        for (;;) {
+            size_t i = _next_job.fetch_add(1);
+            if (i >= _num_jobs) {
+                return;
+            }
+
+            try {
+                (*_job)(i, _buffers[i]->commands);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(_mutex);
+                if (!_error) {
+                    _error = std::current_exception();
+                }
+            }
+
+            if (_pending.fetch_sub(1) == 1) {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _done.notify_all();
+            }
+        }
+    }
+
+    std::vector<std::unique_ptr<Buffer>> _buffers;
+    std::vector<std::thread> _workers;
+
+    std::mutex _mutex;
+    std::condition_variable _wake;
+    std::condition_variable _done;
+
+    const Job* _job;
+    size_t _num_jobs;
+    std::atomic<size_t> _next_job;
+    std::atomic<size_t> _pending;
+    size_t _active;
+    size_t _generation;
+    bool _stop;
+    std::exception_ptr _error;
+};
@@ -0,0 +1,251 @@
+//
+// ChameleonGL - A small framework for OpenGL.
+// Copyright (C) 2012-2017 Srinivas Kaza
+//
+// This file is part of ChameleonGL.
+//
+// ChameleonGL is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ChameleonGL is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ChameleonGL.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <cstddef>
+#include <algorithm>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define CHML_X86_KERNELS 1
+#include <immintrin.h>
+#endif
+
+// Where each channel of a pixel lives, in the terms of SDL_PixelFormat.
+// Channels are R, G, B, A; a channel with a zero mask reads as 0.
+typedef struct {
+    int bytes_per_pixel;
+    uint32_t mask[4];
+    uint8_t shift[4];
+    uint8_t loss[4];
+} ChannelLayout;
+
+// Converts decoded images to tightly packed R, G, B, A bytes, keeping the
+// number of bytes per pixel. Layouts whose channels are whole bytes (RGB24,
+// BGR24, RGBA32, ARGB8888, XRGB8888 and so on) are converted with a byte
+// swizzle: a copy when the order already matches, SSE2/SSSE3/AVX2 shuffles
+// for 4 byte pixels and a table lookup for 3 byte pixels. Anything else
+// takes the generic per-pixel path, which masks and shifts each channel.
+class PixelConverter {
+  public:
+    static void convert(const ChannelLayout& layout,
+                        const uint8_t* src,
+                        const size_t& src_pitch,
+                        const int& width,
+                        const int& height,
+                        uint8_t* dst) {
+        const size_t row_bytes = (size_t) width * layout.bytes_per_pixel;
+        int order[4];
+        if (!byte_order(layout, order)) {
+            for (int j = 0; j < height; j++) {
+                convert_generic(layout, src + j * src_pitch,
+                                dst + j * row_bytes, width);
+            }
+            return;
+        }
+
+        bool identity = true;
+        for (int c = 0; c < layout.bytes_per_pixel; c++) {
+            identity = identity && order[c] == c;
+        }
+
+        for (int j = 0; j < height; j++) {
+            const uint8_t* src_row = src + j * src_pitch;
+            uint8_t* dst_row = dst + j * row_bytes;
+            if (identity) {
+                std::memcpy(dst_row, src_row, row_bytes);
+            } else if (layout.bytes_per_pixel == 4) {
+                swizzle4(src_row, dst_row, width, order);
+            } else {
+                swizzle3(src_row, dst_row, width, order);
+            }
+        }
+    }
+
+    // The original per-pixel conversion: every channel is masked, shifted
+    // and widened by its loss. Only the first `bytes_per_pixel` channels are
+    // written.
+    static void convert_generic(const ChannelLayout& layout,
+                                const uint8_t* src,
+                                uint8_t* dst,
+                                const int& width) {
+        const int bpp = layout.bytes_per_pixel;
+        const int channels = std::min(bpp, 4);
+        for (int i = 0; i < width; i++) {
+            uint32_t pixel = 0;
+            std::memcpy(&pixel, src + i * bpp, std::min(bpp, 4));
+            for (int c = 0; c < channels; c++) {
+                uint32_t value = (pixel & layout.mask[c]) >> layout.shift[c];
+                dst[i * bpp + c] = (uint8_t)(value << layout.loss[c]);
+            }
+        }
+    }
+
+  private:
+    // Finds the source byte of each channel, or -1 for a channel that is
+    // always 0. Returns false unless every channel is a whole byte.
+    static bool byte_order(const ChannelLayout& layout, int* order) {
+        const uint16_t endian_test = 1;
+        const bool little_endian = *((const uint8_t*) &endian_test) == 1;
+        const int bpp = layout.bytes_per_pixel;
+        if (!little_endian || (bpp != 3 && bpp != 4)) {
+            return false;
+        }
+
+        for (int c = 0; c < bpp; c++) {
+            if (layout.mask[c] == 0) {
+                order[c] = -1;
+                continue;
+            }
+            if (layout.loss[c] != 0 || layout.shift[c] % 8 != 0 ||
+                    layout.shift[c] / 8 >= bpp ||
+                    layout.mask[c] != (0xffu << layout.shift[c])) {
+                return false;
+            }
+            order[c] = layout.shift[c] / 8;
+        }
+        return true;
+    }
+
+    static void swizzle3(const uint8_t* src,
+                         uint8_t* dst,
+                         const int& width,
+                         const int* order) {
+        for (int i = 0; i < width; i++) {
+            for (int c = 0; c < 3; c++) {
+                dst[3 * i + c] = order[c] < 0 ? 0 : src[3 * i + order[c]];
+            }
+        }
+    }
+
+    static void swizzle4(const uint8_t* src,
+                         uint8_t* dst,
+                         const int& width,
+                         const int* order) {
+        int done = 0;
+#ifdef CHML_X86_KERNELS
+        if (has_avx2()) {
+            done = swizzle4_avx2(src, dst, width, order);
+        } else if (has_ssse3()) {
+            done = swizzle4_ssse3(src, dst, width, order);
+        } else {
+            done = swizzle4_sse2(src, dst, width, order);
+        }
+#endif
+        for (int i = done; i < width; i++) {
+            for (int c = 0; c < 4; c++) {
+                dst[4 * i + c] = order[c] < 0 ? 0 : src[4 * i + order[c]];
+            }
+        }
+    }
+
+#ifdef CHML_X86_KERNELS
+    static bool has_avx2() {
+        static const bool supported = __builtin_cpu_supports("avx2");
+        return supported;
+    }
+
+    static bool has_ssse3() {
+        static const bool supported = __builtin_cpu_supports("ssse3");
+        return supported;
+    }
+
+    // pshufb control for four pixels; 0x80 writes a zero byte
+    static void shuffle_control(const int* order, uint8_t* control) {
+        for (int p = 0; p < 4; p++) {
+            for (int c = 0; c < 4; c++) {
+                control[4 * p + c] = order[c] < 0 ?
+                                     0x80 : (uint8_t)(4 * p + order[c]);
+            }
+        }
+    }
+
+    // Each kernel returns how many pixels it converted; the caller finishes
+    // the rest
+    __attribute__((target("avx2")))
+    static int swizzle4_avx2(const uint8_t* src,
+                             uint8_t* dst,
+                             const int& width,
+                             const int* order) {
+        uint8_t control[16];
+        shuffle_control(order, control);
+        const __m128i lane = _mm_loadu_si128((const __m128i*) control);
+        const __m256i shuffle = _mm256_broadcastsi128_si256(lane);
+
+        int i = 0;
+        for (; i + 8 <= width; i += 8) {
+            __m256i pixels = _mm256_loadu_si256((const __m256i*)(src + 4 * i));
+            _mm256_storeu_si256((__m256i*)(dst + 4 * i),
+                                _mm256_shuffle_epi8(pixels, shuffle));
+        }
+        return i;
+    }
+
+    __attribute__((target("ssse3")))
+    static int swizzle4_ssse3(const uint8_t* src,
+                              uint8_t* dst,
+                              const int& width,
+                              const int* order) {
+        uint8_t control[16];
+        shuffle_control(order, control);
+        const __m128i shuffle = _mm_loadu_si128((const __m128i*) control);
+
+        int i = 0;
+        for (; i + 4 <= width; i += 4) {
+            __m128i pixels = _mm_loadu_si128((const __m128i*)(src + 4 * i));
+            _mm_storeu_si128((__m128i*)(dst + 4 * i),
+                             _mm_shuffle_epi8(pixels, shuffle));
+        }
+        return i;
+    }
+
+    // SSE2 has no byte shuffle, so each channel is shifted out of the
+    // 32-bit pixel and back into place
+    static int swizzle4_sse2(const uint8_t* src,
+                             uint8_t* dst,
+                             const int& width,
+                             const int* order) {
+        const __m128i byte_mask = _mm_set1_epi32(0xff);
+        __m128i from[4];
+        __m128i to[4];
+        for (int c = 0; c < 4; c++) {
+            from[c] = _mm_cvtsi32_si128(order[c] < 0 ? 32 : 8 * order[c]);
+            to[c] = _mm_cvtsi32_si128(8 * c);
+        }
+
+        int i = 0;
+        for (; i + 4 <= width; i += 4) {
+            __m128i pixels = _mm_loadu_si128((const __m128i*)(src + 4 * i));
+            __m128i result = _mm_setzero_si128();
+            for (int c = 0; c < 4; c++) {
+                // A shift by 32 clears the lane, giving the zero channel
+                __m128i channel = _mm_and_si128(_mm_srl_epi32(pixels, from[c]),
+                                                byte_mask);
+                result = _mm_or_si128(result, _mm_sll_epi32(channel, to[c]));
+            }
+            _mm_storeu_si128((__m128i*)(dst + 4 * i), result);
+        }
+        return i;
+    }
+#endif
+};
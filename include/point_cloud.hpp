@@ -22,6 +22,8 @@
 
 #include <vector>
 #include <exception>
+#include <type_traits>
+#include <cstring>
 #include <assert.h>
 
 #include <glm/glm.hpp>
@@ -52,16 +54,49 @@ class PointCloud : public Drawable {
         load_from_vao(vao);
     }
 
-    // TODO: Make a fully generic version of this
-    void init(std::vector<Point> points) {
-        const std::vector<VertexAttribute> attribs({
-            {0, 4, 0, 0}
-        });
-        std::vector<GLfloat*> vertex_data;
-        vertex_data.push_back(&(points[0].position.x));
-        this->vao = VAO(vertex_data,
-                        attribs,
+    // Uploads the points interleaved: a vec3 position at location 0, then
+    // a packed GL_INT_2_10_10_10_REV normal at location 1 and a normalized
+    // 8-bit color at location 2 when the point type has them
+    template <typename NORMAL, typename COLOR>
+    void init(const std::vector<PointT<glm::vec4, NORMAL, COLOR>>& points) {
+        const bool has_normal = !std::is_same<NORMAL, void*>::value;
+        const bool has_color = !std::is_same<COLOR, void*>::value;
+
+        std::vector<VertexFormat> formats({{0, 3, GL_FLOAT, GL_FALSE, 0}});
+        GLuint vertex_size = sizeof(glm::vec3);
+        if (has_normal) {
+            formats.push_back({1, 4, GL_INT_2_10_10_10_REV, GL_TRUE,
+                               vertex_size});
+            vertex_size += sizeof(GLuint);
+        }
+        if (has_color) {
+            formats.push_back({2, 4, GL_UNSIGNED_BYTE, GL_TRUE, vertex_size});
+            vertex_size += sizeof(GLuint);
+        }
+
+        std::vector<uint8_t> vertex_data(points.size() * vertex_size);
+        uint8_t* vertex = vertex_data.data();
+        for (const auto& point : points) {
+            glm::vec3 position(point.position);
+            std::memcpy(vertex, &position, sizeof(glm::vec3));
+            uint8_t* attribute = vertex + sizeof(glm::vec3);
+            if (has_normal) {
+                GLuint normal = pack_attribute(point.normal, false);
+                std::memcpy(attribute, &normal, sizeof(GLuint));
+                attribute += sizeof(GLuint);
+            }
+            if (has_color) {
+                GLuint color = pack_attribute(point.color, true);
+                std::memcpy(attribute, &color, sizeof(GLuint));
+            }
+            vertex += vertex_size;
+        }
+
+        this->vao = VAO(vertex_data.data(),
+                        vertex_size,
+                        formats,
                         points.size(),
+                        std::vector<GLuint>(),
                         GL_POINTS);
     }
 
@@ -78,5 +113,14 @@ class PointCloud : public Drawable {
     };
 
   private:
+    static GLuint pack_attribute(const glm::vec4& value, const bool& color) {
+        return color ? pack_color(value) : pack_normal(glm::vec3(value));
+    }
+
+    // Point types without a normal or color never reach this
+    static GLuint pack_attribute(void* const& value, const bool& color) {
+        return 0;
+    }
+
     VAO vao;
 };
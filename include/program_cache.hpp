@@ -0,0 +1,265 @@
+//
+// ChameleonGL - A small framework for OpenGL.
+// Copyright (C) 2012-2017 Srinivas Kaza
+//
+// This file is part of ChameleonGL.
+//
+// ChameleonGL is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ChameleonGL is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ChameleonGL.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#pragma once
+
+#include <atomic>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <unordered_set>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// OpenGL / glew Headers
+#define GL3_PROTOTYPES 1
+#include <GL/glew.h>
+
+#include "util.hpp"
+
+#define PROGRAM_CACHE_INIT() \
+    std::string ProgramCache::directory; \
+    std::atomic<size_t> ProgramCache::hits(0); \
+    std::atomic<size_t> ProgramCache::misses(0); \
+    std::unordered_set<uint64_t> ProgramCache::valid_sources; \
+    std::mutex ProgramCache::valid_sources_mutex;
+
+typedef struct {
+    GLenum type;
+    std::string source;
+    // The file the source was read from, if any
+    std::string filename;
+} ShaderSource;
+
+// Linked program binaries stored on disk, one file per program, keyed by a
+// hash of the shader sources, their stages and the driver. A changed source
+// or driver produces a different key, so stale binaries are never loaded;
+// a binary the driver rejects anyway counts as a miss and is recompiled.
+//
+// The cache is off until enable() is called, which GraphicsContext does when
+// given the "program_cache" option.
+class ProgramCache {
+  public:
+    static void enable(const std::string& cache_directory) {
+        mkdir(cache_directory.c_str(), 0755);
+        directory = cache_directory;
+    }
+
+    static void disable() {
+        directory.clear();
+    }
+
+    static bool enabled() {
+        return !directory.empty();
+    }
+
+    static uint64_t key(const std::vector<ShaderSource>& sources,
+                        const std::string& driver) {
+        uint64_t h = hash(FNV_OFFSET, driver.data(), driver.size());
+        for (const ShaderSource& source : sources) {
+            h = hash(h, &source.type, sizeof(source.type));
+            h = hash(h, source.source.data(), source.source.size());
+        }
+        return h;
+    }
+
+    // Vendor, renderer and version of the current context
+    static std::string driver_string() {
+        std::string driver;
+        const GLenum names[] = {GL_VENDOR, GL_RENDERER, GL_VERSION};
+        for (GLenum name : names) {
+            const GLubyte* str = glGetString(name);
+            if (str != nullptr) {
+                driver += (const char*) str;
+            }
+            driver += '\n';
+        }
+        return driver;
+    }
+
+    // Replaces the program with the binary cached under `key`. Returns
+    // false, leaving the program unlinked, if there is none or the driver
+    // rejects it.
+    static bool load(const GLuint& program, const uint64_t& key) {
+        GLenum format;
+        std::vector<uint8_t> binary;
+        if (!read_binary(path(key), format, binary)) {
+            misses++;
+            return false;
+        }
+
+        glProgramBinary(program, format, binary.data(),
+                        (GLsizei) binary.size());
+        GLint linked = GL_FALSE;
+        glGetProgramiv(program, GL_LINK_STATUS, &linked);
+        if (linked == GL_FALSE) {
+            misses++;
+            return false;
+        }
+
+        hits++;
+        return true;
+    }
+
+    // Saves a linked program. The program should have been linked with
+    // GL_PROGRAM_BINARY_RETRIEVABLE_HINT set.
+    static void store(const GLuint& program, const uint64_t& key) {
+        GLint length = 0;
+        glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (length <= 0) {
+            return;
+        }
+
+        GLenum format;
+        std::vector<uint8_t> binary(length);
+        glGetProgramBinary(program, length, &length, &format, binary.data());
+        binary.resize(length);
+
+        if (!write_binary(path(key), format, binary)) {
+            ERROR("Could not write program binary " << path(key));
+        }
+    }
+
+    // Single shaders have no binary form, so for sources that are only
+    // compiled to check them for errors the cache just remembers which
+    // ones compiled cleanly during this run
+    static bool is_valid_source(const uint64_t& key) {
+        std::lock_guard<std::mutex> lock(valid_sources_mutex);
+        return valid_sources.count(key) != 0;
+    }
+
+    static void set_valid_source(const uint64_t& key) {
+        std::lock_guard<std::mutex> lock(valid_sources_mutex);
+        valid_sources.insert(key);
+    }
+
+    static uint64_t source_key(const std::string& source,
+                               const GLenum& type) {
+        uint64_t h = hash(FNV_OFFSET, &type, sizeof(type));
+        return hash(h, source.data(), source.size());
+    }
+
+    static bool write_binary(const std::string& filename,
+                             const GLenum& format,
+                             const std::vector<uint8_t>& binary) {
+        // Written to a temporary file of its own first, so that a reader
+        // never sees a partial binary and concurrent writers do not collide
+        std::string tmp = filename + ".XXXXXX";
+        int fd = mkstemp(&tmp[0]);
+        if (fd < 0) {
+            return false;
+        }
+        fchmod(fd, 0644);
+
+        uint32_t header[3] = {
+            MAGIC, (uint32_t) format, (uint32_t) binary.size()
+        };
+        bool written = write_all(fd, (const uint8_t*) header,
+                                 sizeof(header)) &&
+                       write_all(fd, binary.data(), binary.size());
+        written = ::close(fd) == 0 && written;
+        if (!written || std::rename(tmp.c_str(), filename.c_str()) != 0) {
+            unlink(tmp.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    static bool read_binary(const std::string& filename,
+                            GLenum& format,
+                            std::vector<uint8_t>& binary) {
+        std::ifstream in(filename, std::ios::binary | std::ios::ate);
+        std::streamoff file_size = in.tellg();
+        in.seekg(0);
+        uint32_t header[3];
+        if (!in.read((char*) header, sizeof(header)) || header[0] != MAGIC) {
+            return false;
+        }
+
+        // The length is only trusted if the file holds exactly that much,
+        // so a corrupt entry cannot ask for a huge allocation
+        if ((std::streamoff) header[2] !=
+                file_size - (std::streamoff) sizeof(header)) {
+            return false;
+        }
+
+        format = (GLenum) header[1];
+        binary.resize(header[2]);
+        return (bool) in.read((char*) binary.data(), binary.size());
+    }
+
+    static size_t get_hits() {
+        return hits.load();
+    }
+
+    static size_t get_misses() {
+        return misses.load();
+    }
+
+  private:
+    static bool write_all(const int& fd,
+                          const uint8_t* data,
+                          const size_t& size) {
+        size_t done = 0;
+        while (done < size) {
+            ssize_t n = ::write(fd, data + done, size - done);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return false;
+            }
+            done += (size_t) n;
+        }
+        return true;
+    }
+
+    static std::string path(const uint64_t& key) {
+        char name[32];
+        std::snprintf(name, sizeof(name), "%016llx.bin",
+                      (unsigned long long) key);
+        return directory + "/" + name;
+    }
+
+    // FNV-1a
+    static uint64_t hash(uint64_t h, const void* data, const size_t& size) {
+        const uint8_t* bytes = (const uint8_t*) data;
+        for (size_t i = 0; i < size; i++) {
+            h ^= bytes[i];
+            h *= 0x100000001b3ULL;
+        }
+        return h;
+    }
+
+    static std::string directory;
+    static std::atomic<size_t> hits;
+    static std::atomic<size_t> misses;
+    static std::unordered_set<uint64_t> valid_sources;
+    static std::mutex valid_sources_mutex;
+
+    constexpr static uint64_t FNV_OFFSET = 0xcbf29ce484222325ULL;
+    constexpr static uint32_t MAGIC = 0x42504843;
+};
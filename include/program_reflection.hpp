@@ -0,0 +1,300 @@
+//
+// ChameleonGL - A small framework for OpenGL.
+// Copyright (C) 2012-2017 Srinivas Kaza
+//
+// This file is part of ChameleonGL.
+//
+// ChameleonGL is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ChameleonGL is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ChameleonGL.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#pragma once
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+// OpenGL / glew Headers
+#define GL3_PROTOTYPES 1
+#include <GL/glew.h>
+
+#include "util.hpp"
+#include "uniform_block.hpp"
+
+// Resource names are compared by a 64-bit FNV-1a hash of the name
+typedef uint64_t NameId;
+
+constexpr NameId intern_name(const char* name, const size_t& length) {
+    NameId h = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < length; i++) {
+        h ^= (uint8_t) name[i];
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+inline NameId intern_name(const std::string& name) {
+    return intern_name(name.data(), name.size());
+}
+
+constexpr size_t name_length(const char* name) {
+    size_t length = 0;
+    while (name[length] != '\0') {
+        length++;
+    }
+    return length;
+}
+
+// A uniform name together with its id. Names written as "name"_u are
+// hashed at compile time and kept by pointer, since a literal lives
+// forever. Any other name only points at the caller's string, and a
+// UniformMap that keeps it makes its own copy.
+class UniformName {
+  public:
+    constexpr UniformName(const char* name) :
+        id(intern_name(name, name_length(name))),
+        name(name),
+        is_literal(false) {
+
+    }
+
+    UniformName(const std::string& name) :
+        id(intern_name(name)),
+        name(name.c_str()),
+        is_literal(false) {
+
+    }
+
+    constexpr UniformName(const NameId& id,
+                          const char* name,
+                          const bool& is_literal) :
+        id(id),
+        name(name),
+        is_literal(is_literal) {
+
+    }
+
+    NameId id;
+    // May be nullptr when only the id is known
+    const char* name;
+    // Whether name has static storage
+    bool is_literal;
+};
+
+constexpr UniformName operator"" _u(const char* name, size_t length) {
+    return UniformName(intern_name(name, length), name, true);
+}
+
+inline std::ostream& operator<< (std::ostream& out, const UniformName& name) {
+    if (name.name != nullptr) {
+        out << name.name;
+    } else {
+        out << "#" << name.id;
+    }
+    return out;
+}
+
+typedef struct {
+    NameId id;
+    std::string name;
+    // GL_NONE for shader storage blocks
+    GLenum type;
+    // The binding for shader storage blocks
+    GLint location;
+    GLint array_size;
+    GLuint index;
+} ProgramResource;
+
+// Index of a uniform in its program's reflection. The name is kept so that
+// a handle taken before a relink still finds its uniform afterwards.
+typedef struct {
+    int32_t index;
+    NameId id;
+} UniformHandle;
+
+// Every active uniform, vertex attribute, shader storage block and uniform
+// block of a linked program. The tables are sorted by name id so a lookup
+// is a binary search over integers; callers that look a uniform up once
+// and keep the handle pay nothing per set.
+class ProgramReflection {
+  public:
+    ProgramReflection() :
+        uniforms(),
+        attributes(),
+        storage_blocks(),
+        uniform_blocks() {
+
+    }
+
+    static ProgramReflection reflect(const GLuint& program) {
+        const GLenum variable_properties[] = {
+            GL_NAME_LENGTH, GL_TYPE, GL_LOCATION, GL_ARRAY_SIZE
+        };
+        const GLenum block_properties[] = {
+            GL_NAME_LENGTH, GL_BUFFER_BINDING
+        };
+
+        ProgramReflection reflection;
+        reflect_interface(program, GL_UNIFORM, variable_properties, 4,
+                          reflection.uniforms);
+        reflect_interface(program, GL_PROGRAM_INPUT, variable_properties, 4,
+                          reflection.attributes);
+        reflect_interface(program, GL_SHADER_STORAGE_BLOCK,
+                          block_properties, 2, reflection.storage_blocks);
+
+        GLint num_blocks = 0;
+        glGetProgramInterfaceiv(program, GL_UNIFORM_BLOCK,
+                                GL_ACTIVE_RESOURCES, &num_blocks);
+        for (GLint i = 0; i < num_blocks; i++) {
+            reflection.uniform_blocks.push_back(
+                UniformBlockLayout::reflect(program, (GLuint) i));
+        }
+
+        reflection.sort();
+        return reflection;
+    }
+
+    void sort() {
+        sort_resources(uniforms);
+        sort_resources(attributes);
+        sort_resources(storage_blocks);
+    }
+
+    static const ProgramResource* find(
+        const std::vector<ProgramResource>& resources,
+        const NameId& id) {
+        auto it = std::lower_bound(resources.begin(), resources.end(), id,
+                                   [](const ProgramResource& a,
+                                      const NameId& b) {
+                                       return a.id < b;
+                                   });
+        if (it == resources.end() || it->id != id) {
+            return nullptr;
+        }
+        return &(*it);
+    }
+
+    UniformHandle uniform_handle(const NameId& id) const {
+        const ProgramResource* uniform = find(uniforms, id);
+        if (uniform == nullptr) {
+            return UniformHandle({-1, id});
+        }
+        return UniformHandle({(int32_t)(uniform - uniforms.data()), id});
+    }
+
+    // Location of the uniform behind `handle`, or -1
+    GLint location(const UniformHandle& handle) const {
+        if (handle.index >= 0 && (size_t) handle.index < uniforms.size() &&
+                uniforms[handle.index].id == handle.id) {
+            return uniforms[handle.index].location;
+        }
+
+        // Stale handle from before a relink
+        const ProgramResource* uniform = find(uniforms, handle.id);
+        return uniform == nullptr ? -1 : uniform->location;
+    }
+
+    // Sorted by name id
+    std::vector<ProgramResource> uniforms;
+    std::vector<ProgramResource> attributes;
+    std::vector<ProgramResource> storage_blocks;
+
+    std::vector<UniformBlockLayout> uniform_blocks;
+
+  private:
+    static void add_array_elements(const GLuint& program,
+                                   const ProgramResource& first,
+                                   const std::string& base_name,
+                                   std::vector<ProgramResource>& resources) {
+        for (GLint element = 1; element < first.array_size; element++) {
+            ProgramResource resource = first;
+            resource.name = base_name + "[" + std::to_string(element) + "]";
+            resource.id = intern_name(resource.name);
+            resource.location =
+                glGetProgramResourceLocation(program, GL_UNIFORM,
+                                             resource.name.c_str());
+            resource.array_size = first.array_size - element;
+            resources.push_back(resource);
+        }
+    }
+
+    static void reflect_interface(const GLuint& program,
+                                  const GLenum& interface,
+                                  const GLenum* properties,
+                                  const GLsizei& num_properties,
+                                  std::vector<ProgramResource>& resources) {
+        GLint num_resources = 0;
+        glGetProgramInterfaceiv(program, interface, GL_ACTIVE_RESOURCES,
+                                &num_resources);
+
+        for (GLint i = 0; i < num_resources; i++) {
+            GLint values[4] = {0, GL_NONE, -1, 1};
+            glGetProgramResourceiv(program, interface, i,
+                                   num_properties, properties,
+                                   num_properties, nullptr, values);
+
+            std::string name(std::max(values[0], 1), '\0');
+            GLsizei written = 0;
+            glGetProgramResourceName(program, interface, i,
+                                     (GLsizei) name.size(), &written,
+                                     &name[0]);
+            name.resize(written);
+
+            ProgramResource resource;
+            resource.index = (GLuint) i;
+            if (num_properties == 4) {
+                resource.type = (GLenum) values[1];
+                resource.location = values[2];
+                resource.array_size = values[3];
+            } else {
+                resource.type = GL_NONE;
+                resource.location = values[1];
+                resource.array_size = 1;
+            }
+
+            // Arrays are reported as their first element, but are looked up
+            // by either name. Every other element of a uniform array gets
+            // its own entry, so "lights[3]" never has to ask the driver.
+            if (name.size() > 3 &&
+                    name.compare(name.size() - 3, 3, "[0]") == 0) {
+                resource.name = name;
+                resource.id = intern_name(name);
+                resources.push_back(resource);
+                name.resize(name.size() - 3);
+
+                if (interface == GL_UNIFORM && resource.location != -1) {
+                    add_array_elements(program, resource, name, resources);
+                }
+            }
+            resource.name = name;
+            resource.id = intern_name(name);
+            resources.push_back(resource);
+        }
+    }
+
+    static void sort_resources(std::vector<ProgramResource>& resources) {
+        std::sort(resources.begin(), resources.end(),
+                  [](const ProgramResource& a, const ProgramResource& b) {
+                      return a.id < b.id;
+                  });
+        for (size_t i = 1; i < resources.size(); i++) {
+            if (resources[i].id == resources[i - 1].id) {
+                ERROR("Resources " << resources[i - 1].name << " and " <<
+                      resources[i].name << " have the same name id!");
+            }
+        }
+    }
+};
@@ -0,0 +1,86 @@
+//
+// ChameleonGL - A small framework for OpenGL.
+// Copyright (C) 2012-2017 Srinivas Kaza
+//
+// This file is part of ChameleonGL.
+//
+// ChameleonGL is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ChameleonGL is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ChameleonGL.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#pragma once
+
+#include <future>
+
+#include "abstract_surface.hpp"
+#include "command.hpp"
+#include "readback_queue.hpp"
+
+// Reads a surface back at its position in the frame, after the commands
+// recorded before it have rendered. Like any command other than a draw, it
+// is a barrier that CommandBucket never sorts draws across. The future is
+// resolved by ReadbackQueue::poll() once the GPU has finished the copy,
+// usually a frame or two later.
+class ReadbackCommand : public Command {
+  public:
+    ReadbackCommand(AbstractSurfacePtr surface,
+                    ReadbackQueue& queue,
+                    const GLenum& format = GL_RGBA,
+                    const GLenum& type = GL_UNSIGNED_BYTE) :
+        ReadbackCommand(surface, queue, 0, 0, surface->get_width(),
+                        surface->get_height(), format, type) {
+
+    }
+
+    ReadbackCommand(AbstractSurfacePtr surface,
+                    ReadbackQueue& queue,
+                    const GLint& x,
+                    const GLint& y,
+                    const GLsizei& width,
+                    const GLsizei& height,
+                    const GLenum& format = GL_RGBA,
+                    const GLenum& type = GL_UNSIGNED_BYTE) :
+        Command(COMMAND_READBACK),
+        _surface(surface),
+        _queue(queue),
+        _x(x),
+        _y(y),
+        _width(width),
+        _height(height),
+        _format(format),
+        _type(type),
+        _promise() {
+
+    }
+
+    // May only be called once
+    std::future<Readback> get_future() {
+        return _promise.get_future();
+    }
+
+    void operator()() override {
+        _queue.read(*_surface, _x, _y, _width, _height, _format, _type,
+                    std::move(_promise));
+    }
+
+  private:
+    AbstractSurfacePtr _surface;
+    ReadbackQueue& _queue;
+    GLint _x;
+    GLint _y;
+    GLsizei _width;
+    GLsizei _height;
+    GLenum _format;
+    GLenum _type;
+    std::promise<Readback> _promise;
+};
@@ -0,0 +1,291 @@
+//
+// ChameleonGL - A small framework for OpenGL.
+// Copyright (C) 2012-2017 Srinivas Kaza
+//
+// This file is part of ChameleonGL.
+//
+// ChameleonGL is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ChameleonGL is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ChameleonGL.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <future>
+#include <atomic>
+#include <cstdint>
+#include <stdexcept>
+
+// OpenGL / glew Headers
+#define GL3_PROTOTYPES 1
+#include <GL/glew.h>
+
+#include "util.hpp"
+#include "gl_state.hpp"
+#include "abstract_surface.hpp"
+#include "opengl_utils.hpp"
+
+// Pixels read back from a surface. `data` points straight into the mapped
+// pixel pack buffer the GPU copied them to, with rows tightly packed and
+// bottom row first, as glReadPixels returns them. The buffer is reused once
+// every copy of the Readback is gone, and none may outlive the GL context.
+typedef struct {
+    int width;
+    int height;
+    GLenum format;
+    GLenum type;
+    const uint8_t* data;
+    size_t size;
+    std::shared_ptr<void> lease;
+} Readback;
+
+// Reads pixels back without stalling the pipeline. read() issues
+// glReadPixels into one of a pool of persistently mapped pixel pack buffers
+// and fences it; poll(), called once per frame on the GL thread, resolves
+// the future of every read whose fence has signaled. The pool grows when
+// every buffer is still waiting on the GPU or held by a Readback.
+class ReadbackQueue {
+  public:
+    explicit ReadbackQueue(const size_t& num_buffers = 3) :
+        _slots() {
+        for (size_t i = 0; i < num_buffers; i++) {
+            _slots.push_back(std::make_shared<Slot>());
+        }
+    }
+
+    ReadbackQueue(const ReadbackQueue& other) = delete;
+    ReadbackQueue& operator=(const ReadbackQueue& other) = delete;
+
+    ~ReadbackQueue() {
+        destroy();
+    }
+
+    // Frees every buffer. Reads still in flight are abandoned, so their
+    // futures report a broken promise. Must be called before the GL context
+    // is destroyed if the queue outlives it.
+    void destroy() {
+        for (std::shared_ptr<Slot>& slot : _slots) {
+            if (slot->fence != nullptr) {
+                glDeleteSync(slot->fence);
+                slot->fence = nullptr;
+                slot->promise = std::promise<Readback>();
+            }
+            if (slot->buffer != 0) {
+                glUnmapNamedBuffer(slot->buffer);
+                glDeleteBuffers(1, &slot->buffer);
+                GLState::forget_buffer(slot->buffer);
+                slot->buffer = 0;
+                slot->mapped = nullptr;
+                slot->capacity = 0;
+            }
+        }
+    }
+
+    // Reads all of `surface`
+    std::future<Readback> read(const AbstractSurface& surface,
+                               const GLenum& format = GL_RGBA,
+                               const GLenum& type = GL_UNSIGNED_BYTE) {
+        return read(surface, 0, 0, surface.get_width(),
+                    surface.get_height(), format, type);
+    }
+
+    std::future<Readback> read(const AbstractSurface& surface,
+                               const GLint& x,
+                               const GLint& y,
+                               const GLsizei& width,
+                               const GLsizei& height,
+                               const GLenum& format = GL_RGBA,
+                               const GLenum& type = GL_UNSIGNED_BYTE) {
+        std::promise<Readback> promise;
+        std::future<Readback> future = promise.get_future();
+        read(surface, x, y, width, height, format, type, std::move(promise));
+        return future;
+    }
+
+    // Issues a read that fulfills `promise`. Must be called on the GL
+    // thread, after the commands rendering to `surface` have been issued.
+    void read(const AbstractSurface& surface,
+              const GLint& x,
+              const GLint& y,
+              const GLsizei& width,
+              const GLsizei& height,
+              const GLenum& format,
+              const GLenum& type,
+              std::promise<Readback> promise) {
+        if (width <= 0 || height <= 0) {
+            throw std::runtime_error("Cannot read back an empty rectangle");
+        }
+
+        const size_t size = (size_t) width * height * pixel_size(format, type);
+        Slot& slot = acquire(size);
+        slot.width = width;
+        slot.height = height;
+        slot.format = format;
+        slot.type = type;
+        slot.size = size;
+        slot.promise = std::move(promise);
+
+        const GLuint fbo = surface.get_framebuffer_id();
+        GLState::bind_framebuffer(GL_READ_FRAMEBUFFER, fbo);
+        glNamedFramebufferReadBuffer(fbo, surface.get_read_buffer());
+        GLState::bind_buffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glReadPixels(x, y, width, height, format, type, nullptr);
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+        // Reads into client memory elsewhere must not write to the pool
+        GLState::unbind_buffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+
+        slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+
+    // Resolves every read the GPU has finished, without waiting on the
+    // rest. Must be called on the GL thread. Returns the number resolved.
+    size_t poll() {
+        size_t resolved = 0;
+        for (std::shared_ptr<Slot>& slot : _slots) {
+            if (slot->fence == nullptr) {
+                continue;
+            }
+
+            GLenum status = glClientWaitSync(slot->fence, 0, 0);
+            if (status == GL_WAIT_FAILED) {
+                ERROR("Polling a readback fence failed!");
+            }
+            if (status != GL_ALREADY_SIGNALED &&
+                    status != GL_CONDITION_SATISFIED) {
+                continue;
+            }
+            glDeleteSync(slot->fence);
+            slot->fence = nullptr;
+
+            // The slot is free again once the last copy of the lease, and
+            // with it the Readback, is destroyed on whichever thread
+            std::shared_ptr<Slot> lease_slot = slot;
+            Readback readback;
+            readback.width = slot->width;
+            readback.height = slot->height;
+            readback.format = slot->format;
+            readback.type = slot->type;
+            readback.data = slot->mapped;
+            readback.size = slot->size;
+            readback.lease = std::shared_ptr<void>(
+            nullptr, [lease_slot](void*) {
+                lease_slot->in_use.store(false);
+            });
+
+            std::promise<Readback> promise = std::move(slot->promise);
+            promise.set_value(std::move(readback));
+            resolved++;
+        }
+        return resolved;
+    }
+
+    // Reads issued but not resolved yet
+    size_t pending() const {
+        size_t count = 0;
+        for (const std::shared_ptr<Slot>& slot : _slots) {
+            if (slot->fence != nullptr) {
+                count++;
+            }
+        }
+        return count;
+    }
+
+  private:
+    struct Slot {
+        Slot() :
+            buffer(0),
+            mapped(nullptr),
+            capacity(0),
+            fence(nullptr),
+            in_use(false),
+            width(0),
+            height(0),
+            format(GL_RGBA),
+            type(GL_UNSIGNED_BYTE),
+            size(0),
+            promise() {
+
+        }
+
+        GLuint buffer;
+        uint8_t* mapped;
+        size_t capacity;
+        GLsync fence;
+        // Set from issuing the read until its Readback is released
+        std::atomic<bool> in_use;
+
+        int width;
+        int height;
+        GLenum format;
+        GLenum type;
+        size_t size;
+        std::promise<Readback> promise;
+    };
+
+    // Finds a free slot whose buffer holds `size` bytes, growing its buffer
+    // or the pool if there is none
+    Slot& acquire(const size_t& size) {
+        Slot* free_slot = nullptr;
+        for (std::shared_ptr<Slot>& slot : _slots) {
+            if (slot->in_use.load()) {
+                continue;
+            }
+            if (slot->capacity >= size) {
+                free_slot = slot.get();
+                break;
+            }
+            if (free_slot == nullptr) {
+                free_slot = slot.get();
+            }
+        }
+        if (free_slot == nullptr) {
+            _slots.push_back(std::make_shared<Slot>());
+            free_slot = _slots.back().get();
+        }
+
+        if (free_slot->capacity < size) {
+            allocate(*free_slot, size);
+        }
+        free_slot->in_use.store(true);
+        return *free_slot;
+    }
+
+    // Buffer storage is immutable, so a buffer that is too small is replaced
+    void allocate(Slot& slot, const size_t& size) {
+        if (slot.buffer != 0) {
+            glUnmapNamedBuffer(slot.buffer);
+            glDeleteBuffers(1, &slot.buffer);
+            GLState::forget_buffer(slot.buffer);
+        }
+
+        GLbitfield flags = GL_MAP_READ_BIT | GL_MAP_PERSISTENT_BIT |
+                           GL_MAP_COHERENT_BIT;
+        glCreateBuffers(1, &slot.buffer);
+        glNamedBufferStorage(slot.buffer, (GLsizeiptr) size, nullptr,
+                             flags | GL_CLIENT_STORAGE_BIT);
+        slot.mapped = (uint8_t*) glMapNamedBufferRange(
+                          slot.buffer, 0, (GLsizeiptr) size, flags);
+        if (slot.mapped == nullptr) {
+            ERROR("Could not map a readback buffer! Error: " <<
+                  glGetError());
+            exit(1);
+        }
+        slot.capacity = size;
+    }
+
+    // Slots are shared with the leases of the Readbacks handed out from
+    // them, which may outlive the queue
+    std::vector<std::shared_ptr<Slot>> _slots;
+};
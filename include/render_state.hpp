@@ -22,11 +22,9 @@
 
 #include <iostream>
 #include <climits>
-#include <unordered_set>
-#include <unordered_map>
-#include <memory>
-#include <functional>
-#include <exception>
+#include <cstdint>
+#include <initializer_list>
+#include <stdexcept>
 
 #include <glm/glm.hpp>
 #include <glm/gtx/transform.hpp>
@@ -123,215 +121,540 @@ typedef struct {
     glm::ivec4 box = glm::ivec4(0, 0, 0, 0);
 } ScissorBox;
 
+inline bool operator==(const BlendFunction& a, const BlendFunction& b) {
+    return a.buf == b.buf &&
+           a.src_RGB == b.src_RGB && a.dst_RGB == b.dst_RGB &&
+           a.src_alpha == b.src_alpha && a.dst_alpha == b.dst_alpha;
+}
+
+inline bool operator==(const BlendEquation& a, const BlendEquation& b) {
+    return a.buf == b.buf &&
+           a.mode_RGB == b.mode_RGB && a.mode_alpha == b.mode_alpha;
+}
+
+inline bool operator==(const SampleCoverage& a, const SampleCoverage& b) {
+    return a.value == b.value && a.invert == b.invert;
+}
+
+inline bool operator==(const PolygonOffset& a, const PolygonOffset& b) {
+    return a.factor == b.factor && a.units == b.units;
+}
+
+inline bool operator==(const PolygonMode& a, const PolygonMode& b) {
+    return a.face == b.face && a.mode == b.mode;
+}
+
+inline bool operator==(const SampleMask& a, const SampleMask& b) {
+    return a.mask_number == b.mask_number && a.mask == b.mask;
+}
+
+inline bool operator==(const StencilFunction& a, const StencilFunction& b) {
+    return a.func == b.func && a.ref == b.ref && a.mask == b.mask;
+}
+
+inline bool operator==(const StencilOperation& a, const StencilOperation& b) {
+    return a.sfail == b.sfail && a.dpfail == b.dpfail && a.dppass == b.dppass;
+}
+
+inline bool operator==(const LogicalOperation& a, const LogicalOperation& b) {
+    return a.opcode == b.opcode;
+}
+
+inline bool operator==(const CullFace& a, const CullFace& b) {
+    return a.mode == b.mode;
+}
+
+inline bool operator==(const DepthRange& a, const DepthRange& b) {
+    return a.range == b.range;
+}
+
+inline bool operator==(const DepthFunction& a, const DepthFunction& b) {
+    return a.mode == b.mode;
+}
+
+inline bool operator==(const LineWidth& a, const LineWidth& b) {
+    return a.width == b.width;
+}
+
+inline bool operator==(const PointSize& a, const PointSize& b) {
+    return a.size == b.size;
+}
+
+inline bool operator==(const PrimitiveRestartIndex& a,
+                       const PrimitiveRestartIndex& b) {
+    return a.index == b.index;
+}
+
+inline bool operator==(const MinSampleShading& a, const MinSampleShading& b) {
+    return a.value == b.value;
+}
+
+inline bool operator==(const ScissorBox& a, const ScissorBox& b) {
+    return a.box == b.box;
+}
+
+// A flat, copyable block of pipeline state. Every parameter always holds a
+// value (the GL default unless set_param was called), so two states can be
+// compared slot by slot and only the differences are sent to the driver.
 class RenderState {
   public:
     explicit RenderState(
-        std::unordered_set<GLenum> enabled =
-            std::unordered_set<GLenum>({GL_MULTISAMPLE, GL_DITHER}),
-        std::unordered_map<std::string, std::function<void()>> params =
-            std::unordered_map<std::string, std::function<void()>>()) :
-        _enabled(new std::unordered_set<GLenum>(enabled)),
-        _params(new std::unordered_map<std::string,
-                std::function<void()>>(params)) {
+        std::initializer_list<GLenum> enabled = {GL_MULTISAMPLE, GL_DITHER}) :
+        _enabled(0),
+        _params() {
+        for (GLenum capability : enabled) {
+            enable(capability);
+        }
+    }
+
+    void enable(const GLenum& capability) {
+        _enabled |= capability_bit(capability);
+    }
 
+    void disable(const GLenum& capability) {
+        _enabled &= ~capability_bit(capability);
+    }
+
+    bool is_enabled(const GLenum& capability) const {
+        return (_enabled & capability_bit(capability)) != 0;
     }
 
     void set_param(const BlendFunction& value) {
-        (*_params)["blend_function"] = [value]() {
-            if (value.buf == UINT_MAX) {
-                glBlendFuncSeparate(value.src_RGB,
-                                    value.dst_RGB,
-                                    value.src_alpha,
-                                    value.dst_alpha);
-            } else {
-                glBlendFuncSeparatei(value.buf,
-                                     value.src_RGB,
-                                     value.dst_RGB,
-                                     value.src_alpha,
-                                     value.dst_alpha);
-            }
-        };
+        _params.blend_function = value;
     }
 
     void set_param(const BlendEquation& value) {
-        (*_params)["blend_equation"] = [value]() {
-            if (value.buf == UINT_MAX) {
-                glBlendEquationSeparate(value.mode_RGB,
-                                        value.mode_alpha);
-            } else {
-                glBlendEquationSeparatei(value.buf,
-                                         value.mode_RGB,
-                                         value.mode_alpha);
-            }
-        };
+        _params.blend_equation = value;
     }
 
     void set_param(const LogicalOperation& value) {
-        (*_params)["logical_operation"] = [value]() {
-            glLogicOp(value.opcode);
-        };
+        _params.logical_operation = value;
     }
 
     void set_param(const CullFace& value) {
-        (*_params)["cull_face"] = [value]() {
-            glCullFace(value.mode);
-        };
+        _params.cull_face = value;
     }
 
     void set_param(const DepthRange& value) {
-        (*_params)["depth_range"] = [value]() {
-            glDepthRange(value.range[0], value.range[1]);
-        };
+        _params.depth_range = value;
     }
 
     void set_param(const DepthFunction& value) {
-        (*_params)["depth_function"] = [value]() {
-            glDepthFunc(value.mode);
-        };
+        _params.depth_function = value;
     }
 
     void set_param(const LineWidth& value) {
-        (*_params)["line_width"] = [value]() {
-            glLineWidth(value.width);
-        };
+        _params.line_width = value;
     }
 
     void set_param(const PointSize& value) {
-        (*_params)["point_size"] = [value]() {
-            glPointSize(value.size);
-        };
+        _params.point_size = value;
     }
 
     void set_param(const SampleCoverage& value) {
-        (*_params)["sample_coverage"] = [value]() {
-            glSampleCoverage(value.value, value.invert);
-        };
+        _params.sample_coverage = value;
     }
 
     void set_param(const PolygonOffset& value) {
-        (*_params)["polygon_offset"] = [value]() {
-            glPolygonOffset(value.factor, value.units);
-        };
+        _params.polygon_offset = value;
     }
 
     void set_param(const PolygonMode& value) {
-        (*_params)["polygon_mode"] = [value]() {
-            glPolygonMode(value.face, value.mode);
-        };
+        _params.polygon_mode = value;
     }
 
     void set_param(const PrimitiveRestartIndex& value) {
-        (*_params)["primitive_restart_index"] = [value]() {
-            glPrimitiveRestartIndex(value.index);
-        };
+        _params.primitive_restart_index = value;
     }
 
     void set_param(const MinSampleShading& value) {
-        (*_params)["min_sample_shading"] = [value]() {
-            glMinSampleShading(value.value);
-        };
+        _params.min_sample_shading = value;
     }
 
     void set_param(const SampleMask& value) {
-        (*_params)["sample_mask"] = [value]() {
-            glSampleMaski(value.mask_number, value.mask);
-        };
+        _params.sample_mask = value;
     }
 
     void set_param(const ScissorBox& value) {
-        (*_params)["scissor_box"] = [value]() {
-            glScissor(value.box[0], value.box[1], value.box[2], value.box[3]);
-        };
+        _params.scissor_box = value;
     }
 
     void set_param(const StencilFunction& value) {
-        (*_params)["stencil_function"] = [value]() {
-            glStencilFunc(value.func, value.ref, value.mask);
-        };
+        _params.stencil_function = value;
     }
 
     void set_param(const StencilOperation& value) {
-        (*_params)["stencil_operation"] = [value]() {
-            glStencilOp(value.sfail, value.dpfail, value.dppass);
-        };
+        _params.stencil_operation = value;
     }
 
-    // Applies the diff from this RenderState to the `second` RenderState
-    void apply_diff(const RenderState& second) const {
-        RenderState default_state = construct_default_state();
+    void get_param(BlendFunction& value) const {
+        value = _params.blend_function;
+    }
+
+    void get_param(BlendEquation& value) const {
+        value = _params.blend_equation;
+    }
+
+    void get_param(LogicalOperation& value) const {
+        value = _params.logical_operation;
+    }
+
+    void get_param(CullFace& value) const {
+        value = _params.cull_face;
+    }
+
+    void get_param(DepthRange& value) const {
+        value = _params.depth_range;
+    }
+
+    void get_param(DepthFunction& value) const {
+        value = _params.depth_function;
+    }
+
+    void get_param(LineWidth& value) const {
+        value = _params.line_width;
+    }
+
+    void get_param(PointSize& value) const {
+        value = _params.point_size;
+    }
+
+    void get_param(SampleCoverage& value) const {
+        value = _params.sample_coverage;
+    }
+
+    void get_param(PolygonOffset& value) const {
+        value = _params.polygon_offset;
+    }
+
+    void get_param(PolygonMode& value) const {
+        value = _params.polygon_mode;
+    }
+
+    void get_param(PrimitiveRestartIndex& value) const {
+        value = _params.primitive_restart_index;
+    }
 
-        std::unordered_set<GLenum> to_be_disabled;
-        std::unordered_set<GLenum> to_be_enabled;
+    void get_param(MinSampleShading& value) const {
+        value = _params.min_sample_shading;
+    }
+
+    void get_param(SampleMask& value) const {
+        value = _params.sample_mask;
+    }
+
+    void get_param(ScissorBox& value) const {
+        value = _params.scissor_box;
+    }
+
+    void get_param(StencilFunction& value) const {
+        value = _params.stencil_function;
+    }
 
-        for (auto first_enabled : *_enabled) {
-            if (!(second._enabled->count(first_enabled))) {
-                to_be_disabled.insert(first_enabled);
+    void get_param(StencilOperation& value) const {
+        value = _params.stencil_operation;
+    }
+
+    // Resets a single parameter to the value held by default_state()
+    template <typename T>
+    void reset_param() {
+        T value;
+        default_state().get_param(value);
+        set_param(value);
+    }
+
+    // The GL default state, built once and shared by every caller
+    static const RenderState& default_state() {
+        static const RenderState state;
+        return state;
+    }
+
+    bool operator==(const RenderState& other) const {
+        return _enabled == other._enabled &&
+               _params.blend_function == other._params.blend_function &&
+               _params.blend_equation == other._params.blend_equation &&
+               _params.sample_coverage == other._params.sample_coverage &&
+               _params.polygon_offset == other._params.polygon_offset &&
+               _params.polygon_mode == other._params.polygon_mode &&
+               _params.sample_mask == other._params.sample_mask &&
+               _params.stencil_function == other._params.stencil_function &&
+               _params.stencil_operation == other._params.stencil_operation &&
+               _params.logical_operation == other._params.logical_operation &&
+               _params.cull_face == other._params.cull_face &&
+               _params.depth_range == other._params.depth_range &&
+               _params.depth_function == other._params.depth_function &&
+               _params.line_width == other._params.line_width &&
+               _params.point_size == other._params.point_size &&
+               _params.primitive_restart_index ==
+               other._params.primitive_restart_index &&
+               _params.min_sample_shading == other._params.min_sample_shading &&
+               _params.scissor_box == other._params.scissor_box;
+    }
+
+    bool operator!=(const RenderState& other) const {
+        return !(*this == other);
+    }
+
+    // FNV-1a over every capability and parameter
+    uint64_t hash() const {
+        uint64_t h = 14695981039346656037ULL;
+        h = hash_value(h, _enabled);
+
+        const Params& p = _params;
+        h = hash_value(h, p.blend_function.buf);
+        h = hash_value(h, p.blend_function.src_RGB);
+        h = hash_value(h, p.blend_function.dst_RGB);
+        h = hash_value(h, p.blend_function.src_alpha);
+        h = hash_value(h, p.blend_function.dst_alpha);
+        h = hash_value(h, p.blend_equation.buf);
+        h = hash_value(h, p.blend_equation.mode_RGB);
+        h = hash_value(h, p.blend_equation.mode_alpha);
+        h = hash_value(h, p.sample_coverage.value);
+        h = hash_value(h, p.sample_coverage.invert);
+        h = hash_value(h, p.polygon_offset.factor);
+        h = hash_value(h, p.polygon_offset.units);
+        h = hash_value(h, p.polygon_mode.face);
+        h = hash_value(h, p.polygon_mode.mode);
+        h = hash_value(h, p.sample_mask.mask_number);
+        h = hash_value(h, p.sample_mask.mask);
+        h = hash_value(h, p.stencil_function.func);
+        h = hash_value(h, p.stencil_function.ref);
+        h = hash_value(h, p.stencil_function.mask);
+        h = hash_value(h, p.stencil_operation.sfail);
+        h = hash_value(h, p.stencil_operation.dpfail);
+        h = hash_value(h, p.stencil_operation.dppass);
+        h = hash_value(h, p.logical_operation.opcode);
+        h = hash_value(h, p.cull_face.mode);
+        h = hash_value(h, p.depth_range.range[0]);
+        h = hash_value(h, p.depth_range.range[1]);
+        h = hash_value(h, p.depth_function.mode);
+        h = hash_value(h, p.line_width.width);
+        h = hash_value(h, p.point_size.size);
+        h = hash_value(h, p.primitive_restart_index.index);
+        h = hash_value(h, p.min_sample_shading.value);
+        for (int i = 0; i < 4; i++) {
+            h = hash_value(h, p.scissor_box.box[i]);
+        }
+        return h;
+    }
+
+    // Applies the diff from this RenderState to the `second` RenderState,
+    // issuing GL calls only for the capabilities and parameters that differ
+    void apply_diff(const RenderState& second) const {
+        uint64_t changed = _enabled ^ second._enabled;
+        for (size_t i = 0; changed != 0; i++, changed >>= 1) {
+            if (changed & 1) {
+                if (second._enabled & (uint64_t(1) << i)) {
+                    glEnable(capabilities()[i]);
+                } else {
+                    glDisable(capabilities()[i]);
+                }
             }
         }
 
-        for (auto second_enabled : *(second._enabled)) {
-            if (!(_enabled->count(second_enabled))) {
-                to_be_enabled.insert(second_enabled);
+        diff_param(_params.blend_function, second._params.blend_function);
+        diff_param(_params.blend_equation, second._params.blend_equation);
+        diff_param(_params.sample_coverage, second._params.sample_coverage);
+        diff_param(_params.polygon_offset, second._params.polygon_offset);
+        diff_param(_params.polygon_mode, second._params.polygon_mode);
+        diff_param(_params.sample_mask, second._params.sample_mask);
+        diff_param(_params.stencil_function, second._params.stencil_function);
+        diff_param(_params.stencil_operation,
+                   second._params.stencil_operation);
+        diff_param(_params.logical_operation,
+                   second._params.logical_operation);
+        diff_param(_params.cull_face, second._params.cull_face);
+        diff_param(_params.depth_range, second._params.depth_range);
+        diff_param(_params.depth_function, second._params.depth_function);
+        diff_param(_params.line_width, second._params.line_width);
+        diff_param(_params.point_size, second._params.point_size);
+        diff_param(_params.primitive_restart_index,
+                   second._params.primitive_restart_index);
+        diff_param(_params.min_sample_shading,
+                   second._params.min_sample_shading);
+        diff_param(_params.scissor_box, second._params.scissor_box);
+    }
+
+  private:
+    typedef struct {
+        BlendFunction blend_function;
+        BlendEquation blend_equation;
+        SampleCoverage sample_coverage;
+        PolygonOffset polygon_offset;
+        PolygonMode polygon_mode;
+        SampleMask sample_mask;
+        StencilFunction stencil_function;
+        StencilOperation stencil_operation;
+        LogicalOperation logical_operation;
+        CullFace cull_face;
+        DepthRange depth_range;
+        DepthFunction depth_function;
+        LineWidth line_width;
+        PointSize point_size;
+        PrimitiveRestartIndex primitive_restart_index;
+        MinSampleShading min_sample_shading;
+        ScissorBox scissor_box;
+    } Params;
+
+    constexpr static size_t NUM_CAPABILITIES = 35;
+
+    // Every capability accepted by glEnable/glDisable, in bit order
+    static const GLenum* capabilities() {
+        static const GLenum table[NUM_CAPABILITIES] = {
+            GL_BLEND,
+            GL_CLIP_DISTANCE0,
+            GL_CLIP_DISTANCE1,
+            GL_CLIP_DISTANCE2,
+            GL_CLIP_DISTANCE3,
+            GL_CLIP_DISTANCE4,
+            GL_CLIP_DISTANCE5,
+            GL_CLIP_DISTANCE6,
+            GL_CLIP_DISTANCE7,
+            GL_COLOR_LOGIC_OP,
+            GL_CULL_FACE,
+            GL_DEBUG_OUTPUT,
+            GL_DEBUG_OUTPUT_SYNCHRONOUS,
+            GL_DEPTH_CLAMP,
+            GL_DEPTH_TEST,
+            GL_DITHER,
+            GL_FRAMEBUFFER_SRGB,
+            GL_LINE_SMOOTH,
+            GL_MULTISAMPLE,
+            GL_POLYGON_OFFSET_FILL,
+            GL_POLYGON_OFFSET_LINE,
+            GL_POLYGON_OFFSET_POINT,
+            GL_POLYGON_SMOOTH,
+            GL_PRIMITIVE_RESTART,
+            GL_PRIMITIVE_RESTART_FIXED_INDEX,
+            GL_RASTERIZER_DISCARD,
+            GL_SAMPLE_ALPHA_TO_COVERAGE,
+            GL_SAMPLE_ALPHA_TO_ONE,
+            GL_SAMPLE_COVERAGE,
+            GL_SAMPLE_SHADING,
+            GL_SAMPLE_MASK,
+            GL_SCISSOR_TEST,
+            GL_STENCIL_TEST,
+            GL_TEXTURE_CUBE_MAP_SEAMLESS,
+            GL_PROGRAM_POINT_SIZE
+        };
+        return table;
+    }
+
+    static uint64_t capability_bit(const GLenum& capability) {
+        for (size_t i = 0; i < NUM_CAPABILITIES; i++) {
+            if (capabilities()[i] == capability) {
+                return uint64_t(1) << i;
             }
         }
+        throw std::runtime_error("Unknown capability " + TOS(capability) +
+                                 " in RenderState!");
+    }
 
-        for (auto disable_param : to_be_disabled) {
-            glDisable(disable_param);
+    template <typename T>
+    static uint64_t hash_value(uint64_t h, const T& value) {
+        const unsigned char* bytes =
+            reinterpret_cast<const unsigned char*>(&value);
+        for (size_t i = 0; i < sizeof(T); i++) {
+            h = (h ^ bytes[i]) * 1099511628211ULL;
         }
+        return h;
+    }
 
-        for (auto enable_param : to_be_enabled) {
-            glEnable(enable_param);
+    template <typename T>
+    static void diff_param(const T& first, const T& second) {
+        if (!(first == second)) {
+            apply_param(second);
         }
+    }
 
-        for (auto& param : * (second._params)) {
-            // If the param exists in both states, set the value
-            //
-            // And if the param exists in the second state, but not the first,
-            // set the value
-            //
-            // TODO: Use fancy C++ tricks to compare params and only set if not
-            // equal
-            param.second();
+    static void apply_param(const BlendFunction& value) {
+        if (value.buf == UINT_MAX) {
+            glBlendFuncSeparate(value.src_RGB,
+                                value.dst_RGB,
+                                value.src_alpha,
+                                value.dst_alpha);
+        } else {
+            glBlendFuncSeparatei(value.buf,
+                                 value.src_RGB,
+                                 value.dst_RGB,
+                                 value.src_alpha,
+                                 value.dst_alpha);
         }
+    }
 
-        for (auto& param : *_params) {
-            // If the param exists in the first state, but not the
-            // second, then set the value to the default
-            if (!second._params->count(param.first)) {
-                default_state._params->at(param.first)();
-            }
+    static void apply_param(const BlendEquation& value) {
+        if (value.buf == UINT_MAX) {
+            glBlendEquationSeparate(value.mode_RGB,
+                                    value.mode_alpha);
+        } else {
+            glBlendEquationSeparatei(value.buf,
+                                     value.mode_RGB,
+                                     value.mode_alpha);
         }
     }
 
-  private:
+    static void apply_param(const LogicalOperation& value) {
+        glLogicOp(value.opcode);
+    }
+
+    static void apply_param(const CullFace& value) {
+        glCullFace(value.mode);
+    }
+
+    static void apply_param(const DepthRange& value) {
+        glDepthRange(value.range[0], value.range[1]);
+    }
+
+    static void apply_param(const DepthFunction& value) {
+        glDepthFunc(value.mode);
+    }
+
+    static void apply_param(const LineWidth& value) {
+        glLineWidth(value.width);
+    }
+
+    static void apply_param(const PointSize& value) {
+        glPointSize(value.size);
+    }
+
+    static void apply_param(const SampleCoverage& value) {
+        glSampleCoverage(value.value, value.invert);
+    }
+
+    static void apply_param(const PolygonOffset& value) {
+        glPolygonOffset(value.factor, value.units);
+    }
+
+    static void apply_param(const PolygonMode& value) {
+        glPolygonMode(value.face, value.mode);
+    }
+
+    static void apply_param(const PrimitiveRestartIndex& value) {
+        glPrimitiveRestartIndex(value.index);
+    }
+
+    static void apply_param(const MinSampleShading& value) {
+        glMinSampleShading(value.value);
+    }
+
+    static void apply_param(const SampleMask& value) {
+        glSampleMaski(value.mask_number, value.mask);
+    }
+
+    static void apply_param(const ScissorBox& value) {
+        glScissor(value.box[0], value.box[1], value.box[2], value.box[3]);
+    }
+
+    static void apply_param(const StencilFunction& value) {
+        glStencilFunc(value.func, value.ref, value.mask);
+    }
+
+    static void apply_param(const StencilOperation& value) {
+        glStencilOp(value.sfail, value.dpfail, value.dppass);
+    }
 
-    static RenderState construct_default_state() {
-        RenderState default_state;
-
-        default_state.set_param(BlendFunction());
-        default_state.set_param(BlendEquation());
-        default_state.set_param(SampleCoverage());
-        default_state.set_param(PolygonOffset());
-        default_state.set_param(PolygonMode());
-        default_state.set_param(SampleMask());
-        default_state.set_param(StencilFunction());
-        default_state.set_param(StencilOperation());
-        default_state.set_param(LogicalOperation());
-        default_state.set_param(CullFace());
-        default_state.set_param(DepthRange());
-        default_state.set_param(DepthFunction());
-        default_state.set_param(LineWidth());
-        default_state.set_param(PointSize());
-        default_state.set_param(PrimitiveRestartIndex());
-        default_state.set_param(MinSampleShading());
-        default_state.set_param(ScissorBox());
-
-        return default_state;
-    }
-
-    std::shared_ptr<std::unordered_set<GLenum>> _enabled;
-    std::shared_ptr < std::unordered_map <
-    std::string, std::function<void()>>> _params;
+    uint64_t _enabled;
+    Params _params;
 
     // Add support for glDebugMessageCallback -- perhaps through std::function?
 };
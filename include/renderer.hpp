@@ -24,8 +24,19 @@
 
 #include "abstract_surface.hpp"
 #include "command.hpp"
+#include "frame_command_list.hpp"
 
+// Renderers append their commands for a frame to a FrameCommandList, whose
+// commands live in the frame arena. operator() is an adapter for callers
+// that want a freshly built CommandList instead.
 class Renderer {
   public:
-    virtual CommandList operator()(AbstractSurfacePtr surface) = 0;
+    virtual void record(AbstractSurfacePtr surface,
+                        FrameCommandList& commands) = 0;
+
+    CommandList operator()(AbstractSurfacePtr surface) {
+        FrameCommandList commands;
+        record(surface, commands);
+        return commands.commands();
+    }
 };
@@ -27,7 +27,6 @@
 namespace SDL {
     typedef struct {
         SDL_Window* window;
-        SDL_Renderer* renderer;
         SDL_GLContext gl_context;
         int width;
         int height;
@@ -415,8 +415,22 @@ class ShaderFunction : public ShaderExpression {
                                  defines + "\n#line 0\n" + get_definition() +
                                  "\n\nvoid main() {}";
 
+        // Only the errors matter, so a source known to compile is skipped
+        uint64_t key = ProgramCache::source_key(new_shader, ideal_stage);
+        if (ProgramCache::is_valid_source(key)) {
+            return std::string();
+        }
+
+        ShaderSource source;
+        source.type = ideal_stage;
+        source.source = new_shader;
+
         Program program;
-        return program.compile_shader(new_shader, ideal_stage, false);
+        std::string log = program.compile_source(source, false);
+        if (log.empty()) {
+            ProgramCache::set_valid_source(key);
+        }
+        return log;
     }
 
     ExpressionListPtr _params;
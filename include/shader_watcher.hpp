@@ -0,0 +1,257 @@
+//
+// ChameleonGL - A small framework for OpenGL.
+// Copyright (C) 2012-2017 Srinivas Kaza
+//
+// This file is part of ChameleonGL.
+//
+// ChameleonGL is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ChameleonGL is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ChameleonGL.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include <climits>
+#include <unistd.h>
+#include <sys/inotify.h>
+
+#include "util.hpp"
+#include "opengl_utils.hpp"
+
+// Rebuilds programs whose shader files change on disk. Files are watched
+// through inotify on their directories, so editors that save by replacing
+// the file are seen too. update() is meant to be called once per frame on
+// the GL thread: it starts an asynchronous relink of every program that
+// depends on a changed file, and swaps each new program in with
+// Program::replace once it has linked. A program that fails to build is
+// reported and the old one is kept.
+class ShaderWatcher {
+  public:
+    // Adds the stages of a program that is being rebuilt
+    typedef std::function<void(Program&)> BuildFunction;
+
+    ShaderWatcher() :
+        _fd(inotify_init1(IN_NONBLOCK | IN_CLOEXEC)),
+        _directories(),
+        _watched(),
+        _pending() {
+        if (_fd == -1) {
+            ERROR("Could not initialize inotify, shaders will not be "
+                  "reloaded");
+        }
+    }
+
+    ShaderWatcher(const ShaderWatcher& other) = delete;
+    ShaderWatcher& operator=(const ShaderWatcher& other) = delete;
+
+    ~ShaderWatcher() {
+        if (_fd != -1) {
+            close(_fd);
+        }
+    }
+
+    // Watches the files `program` was read from plus `dependencies`, such
+    // as the files its generated sources (e.g. ShaderFunctions) came from.
+    // Without `build` a rebuilt program re-reads the same stages; programs
+    // assembled from generated strings should pass a function that
+    // regenerates them. The program must be unwatched before it is
+    // destroyed.
+    void watch(Program& program,
+               const std::vector<std::string>& dependencies =
+                   std::vector<std::string>(),
+               BuildFunction build = BuildFunction()) {
+        Watched watched;
+        watched.program = &program;
+        watched.build = build;
+        for (const ShaderSource& source : program.get_shader_sources()) {
+            if (!source.filename.empty()) {
+                watched.files.push_back(source.filename);
+            }
+        }
+        watched.files.insert(watched.files.end(),
+                             dependencies.begin(), dependencies.end());
+
+        for (const std::string& file : watched.files) {
+            watch_directory(directory_of(file));
+        }
+        _watched.push_back(watched);
+    }
+
+    void unwatch(Program& program) {
+        for (auto it = _watched.begin(); it != _watched.end();) {
+            it = it->program == &program ? _watched.erase(it) : it + 1;
+        }
+        for (auto it = _pending.begin(); it != _pending.end();) {
+            it = it->target == &program ? _pending.erase(it) : it + 1;
+        }
+    }
+
+    // Stops watching every program and drops rebuilds in flight
+    void clear() {
+        _watched.clear();
+        _pending.clear();
+    }
+
+    // Returns the number of programs that were swapped
+    size_t update() {
+        std::unordered_set<std::string> changed = read_events();
+        for (Watched& watched : _watched) {
+            if (depends_on(watched, changed)) {
+                rebuild(watched);
+            }
+        }
+
+        size_t swapped = 0;
+        for (auto it = _pending.begin(); it != _pending.end();) {
+            Program& fresh = *(it->fresh);
+            if (fresh.poll_link()) {
+                DEBUG("Reloaded shaders of program " << it->target->id);
+                it->target->replace(fresh);
+                swapped++;
+            } else if (fresh.get_link_status() != PROGRAM_FAILED) {
+                it++;
+                continue;
+            } else {
+                ERROR("Reloading program " << it->target->id <<
+                      " failed, keeping the old one");
+            }
+            it = _pending.erase(it);
+        }
+        return swapped;
+    }
+
+  private:
+    typedef struct {
+        Program* program;
+        std::vector<std::string> files;
+        BuildFunction build;
+    } Watched;
+
+    typedef struct {
+        Program* target;
+        std::unique_ptr<Program> fresh;
+    } Pending;
+
+    static std::string directory_of(const std::string& file) {
+        size_t slash = file.find_last_of('/');
+        if (slash == std::string::npos) {
+            return ".";
+        }
+        return slash == 0 ? "/" : file.substr(0, slash);
+    }
+
+    void watch_directory(const std::string& directory) {
+        if (_fd == -1) {
+            return;
+        }
+        for (auto& entry : _directories) {
+            if (entry.second == directory) {
+                return;
+            }
+        }
+
+        int wd = inotify_add_watch(_fd, directory.c_str(),
+                                   IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+        if (wd == -1) {
+            ERROR("Could not watch shader directory " << directory);
+            return;
+        }
+        _directories[wd] = directory;
+    }
+
+    // Paths of the files changed since the last call, spelled the way they
+    // were passed to watch()
+    std::unordered_set<std::string> read_events() {
+        std::unordered_set<std::string> changed;
+        if (_fd == -1) {
+            return changed;
+        }
+
+        alignas(struct inotify_event)
+        char buffer[4096 + sizeof(struct inotify_event) + NAME_MAX + 1];
+        while (true) {
+            ssize_t length = read(_fd, buffer, sizeof(buffer));
+            if (length <= 0) {
+                break;
+            }
+
+            for (char* ptr = buffer; ptr < buffer + length;) {
+                const struct inotify_event* event =
+                    (const struct inotify_event*) ptr;
+                ptr += sizeof(struct inotify_event) + event->len;
+
+                auto directory = _directories.find(event->wd);
+                if (event->len == 0 || directory == _directories.end()) {
+                    continue;
+                }
+                if (directory->second == ".") {
+                    changed.insert(event->name);
+                } else if (directory->second == "/") {
+                    changed.insert("/" + std::string(event->name));
+                } else {
+                    changed.insert(directory->second + "/" + event->name);
+                }
+            }
+        }
+        return changed;
+    }
+
+    static bool depends_on(const Watched& watched,
+                           const std::unordered_set<std::string>& changed) {
+        for (const std::string& file : watched.files) {
+            if (changed.count(file) != 0) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void rebuild(Watched& watched) {
+        // A newer edit supersedes a rebuild that is still in flight
+        for (auto it = _pending.begin(); it != _pending.end();) {
+            it = it->target == watched.program ? _pending.erase(it) : it + 1;
+        }
+
+        std::unique_ptr<Program> fresh(new Program());
+        if (watched.build) {
+            watched.build(*fresh);
+        } else {
+            for (const ShaderSource& source :
+                    watched.program->get_shader_sources()) {
+                if (!source.filename.empty()) {
+                    fresh->add_shader(source.filename, source.type);
+                } else {
+                    fresh->add_shader(source.source, source.type, false);
+                }
+            }
+        }
+
+        fresh->link_program_async();
+        Pending pending;
+        pending.target = watched.program;
+        pending.fresh = std::move(fresh);
+        _pending.push_back(std::move(pending));
+    }
+
+    int _fd;
+    // Watched directory of each watch descriptor
+    std::unordered_map<int, std::string> _directories;
+    std::vector<Watched> _watched;
+    std::vector<Pending> _pending;
+};
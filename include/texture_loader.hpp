@@ -0,0 +1,250 @@
+//
+// ChameleonGL - A small framework for OpenGL.
+// Copyright (C) 2012-2017 Srinivas Kaza
+//
+// This file is part of ChameleonGL.
+//
+// ChameleonGL is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ChameleonGL is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ChameleonGL.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <memory>
+#include <unordered_set>
+#include <algorithm>
+#include <stdexcept>
+
+#include "util.hpp"
+#include "image_data.hpp"
+#include "opengl_utils.hpp"
+
+#define TEXTURE_LOADER_INIT() \
+    constexpr uint8_t TextureLoader::PLACEHOLDER[4]; \
+    constexpr double TextureLoader::DEFAULT_BUDGET_MS;
+
+// Loads textures in the background. load() returns a Texture at once,
+// showing a 1x1 grey placeholder; worker threads decode and convert the
+// image, and update(), called once per frame on the GL thread, uploads
+// finished images until its time budget runs out. The Texture keeps its GL
+// name throughout, so copies of it (in a UniformMap, say) show the image as
+// soon as it is uploaded. Their width and height stay at the placeholder's
+// until refresh() is called on them.
+//
+// load() and update() make GL calls, so both belong on the GL thread.
+class TextureLoader {
+  public:
+    explicit TextureLoader(
+        const size_t& num_threads =
+            std::max(std::thread::hardware_concurrency(), 2u) - 1) :
+        _jobs(),
+        _decoded(),
+        _pending(),
+        _stop(false),
+        _workers() {
+        for (size_t i = 0; i < num_threads; i++) {
+            _workers.push_back(std::thread(&TextureLoader::worker_loop,
+                                           this));
+        }
+    }
+
+    TextureLoader(const TextureLoader& other) = delete;
+    TextureLoader& operator=(const TextureLoader& other) = delete;
+
+    ~TextureLoader() {
+        shutdown();
+        clear();
+    }
+
+    // Stops and joins the workers. Images already decoded can still be
+    // uploaded, but nothing new is decoded. Call this before shutting down
+    // the image library the workers decode with.
+    void shutdown() {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _stop = true;
+        }
+        _wake.notify_all();
+        for (std::thread& worker : _workers) {
+            worker.join();
+        }
+        _workers.clear();
+    }
+
+    Texture load(const std::string& filename,
+                 const GLint& internal_format,
+                 const TextureParameterSet& parameters =
+                     TextureParameterSet({FILTER_MIN_MAG_LINEAR}),
+                 const bool& mip_map = true) {
+        Texture texture(GL_TEXTURE_2D, 1, 1);
+        texture.set_parameters(parameters);
+        texture.respecify(internal_format, GL_RGBA, GL_UNSIGNED_BYTE,
+                          PLACEHOLDER, 1, 1, false);
+        _pending.insert(texture.id);
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _jobs.push_back(Job({texture, filename, internal_format, mip_map}));
+        }
+        _wake.notify_one();
+        return texture;
+    }
+
+    // Uploads decoded images for up to `budget_ms` milliseconds. At least
+    // one image is uploaded if any is ready, so loading always progresses.
+    // Returns the number of textures that were uploaded.
+    size_t update(const double& budget_ms = DEFAULT_BUDGET_MS) {
+        auto start = std::chrono::steady_clock::now();
+        size_t uploaded = 0;
+        while (true) {
+            Decoded decoded;
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                if (_decoded.empty()) {
+                    break;
+                }
+                decoded = std::move(_decoded.front());
+                _decoded.pop_front();
+            }
+
+            Texture& texture = decoded.job.texture;
+            _pending.erase(texture.id);
+            if (decoded.data) {
+                texture.respecify(decoded.job.internal_format,
+                                  decoded.format, GL_UNSIGNED_BYTE,
+                                  decoded.data.get(),
+                                  decoded.width, decoded.height,
+                                  decoded.job.mip_map);
+                uploaded++;
+            } else {
+                ERROR("Could not load texture " << decoded.job.filename
+                      << ": " << decoded.error);
+            }
+
+            std::chrono::duration<double, std::milli> elapsed =
+                std::chrono::steady_clock::now() - start;
+            if (elapsed.count() >= budget_ms) {
+                break;
+            }
+        }
+        return uploaded;
+    }
+
+    // Whether the image for `texture` has been uploaded (or failed to load)
+    bool is_loaded(const Texture& texture) const {
+        return _pending.count(texture.id) == 0;
+    }
+
+    // Copies the size of the uploaded image into `texture`, returning false
+    // while it still shows the placeholder
+    bool refresh(Texture& texture) const {
+        if (!is_loaded(texture)) {
+            return false;
+        }
+
+        GLint width = 1;
+        GLint height = 1;
+        glGetTextureLevelParameteriv(texture.id, 0, GL_TEXTURE_WIDTH,
+                                     &width);
+        glGetTextureLevelParameteriv(texture.id, 0, GL_TEXTURE_HEIGHT,
+                                     &height);
+        texture.width = width;
+        texture.height = height;
+        texture.depth = 1;
+        return true;
+    }
+
+    // Textures that are still showing the placeholder
+    size_t pending() const {
+        return _pending.size();
+    }
+
+    // Drops every image that has not been uploaded yet. Their textures
+    // keep the placeholder.
+    void clear() {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _jobs.clear();
+        _decoded.clear();
+        _pending.clear();
+    }
+
+    constexpr static double DEFAULT_BUDGET_MS = 2.0;
+
+  private:
+    typedef struct {
+        Texture texture;
+        std::string filename;
+        GLint internal_format;
+        bool mip_map;
+    } Job;
+
+    struct Decoded {
+        Job job;
+        int width;
+        int height;
+        GLenum format;
+        std::unique_ptr<uint8_t[]> data;
+        std::string error;
+    };
+
+    void worker_loop() {
+        while (true) {
+            Decoded decoded;
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _wake.wait(lock, [this]() {
+                    return _stop || !_jobs.empty();
+                });
+                if (_stop) {
+                    return;
+                }
+                decoded.job = _jobs.front();
+                _jobs.pop_front();
+            }
+
+            try {
+                ImageData image = ImagePool::decode(decoded.job.filename);
+                decoded.width = image.width;
+                decoded.height = image.height;
+                decoded.format = image.format;
+                decoded.data.reset((uint8_t*) image.data);
+            } catch (const std::exception& e) {
+                decoded.error = e.what();
+            }
+
+            std::lock_guard<std::mutex> lock(_mutex);
+            _decoded.push_back(std::move(decoded));
+        }
+    }
+
+    constexpr static uint8_t PLACEHOLDER[4] = {128, 128, 128, 255};
+
+    std::deque<Job> _jobs;
+    std::deque<Decoded> _decoded;
+    // GL names of textures still waiting for their image; only touched on
+    // the GL thread
+    std::unordered_set<GLuint> _pending;
+
+    std::mutex _mutex;
+    std::condition_variable _wake;
+    bool _stop;
+    std::vector<std::thread> _workers;
+};
@@ -0,0 +1,349 @@
+//
+// ChameleonGL - A small framework for OpenGL.
+// Copyright (C) 2012-2017 Srinivas Kaza
+//
+// This file is part of ChameleonGL.
+//
+// ChameleonGL is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ChameleonGL is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ChameleonGL.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#pragma once
+
+#include <deque>
+#include <vector>
+#include <mutex>
+#include <cstring>
+#include <cstdint>
+#include <stdexcept>
+
+// OpenGL / glew Headers
+#define GL3_PROTOTYPES 1
+#include <GL/glew.h>
+
+#include "util.hpp"
+#include "gl_state.hpp"
+#include "opengl_utils.hpp"
+
+// Streams texture updates through one persistently mapped pixel unpack
+// buffer used as a ring. Any thread may write() a sub-rectangle: the pixels
+// are copied into the mapped memory and the update is queued. flush(),
+// called once per frame on the GL thread, turns queued updates into
+// glTextureSubImage2D calls reading from the buffer and fences them; space
+// is only reused once that fence has signaled.
+//
+// Neither side ever waits on the GPU. write() returns false when the ring
+// is full, and the caller decides whether to drop or retry the update.
+//
+// The buffer is only created once something is streamed: the first write()
+// returns false and asks the next flush() to create it, so a program that
+// never streams does not map any memory.
+class TextureStreamer {
+  public:
+    explicit TextureStreamer(const size_t& capacity = 64 << 20) :
+        _id(0),
+        _mapped(nullptr),
+        _capacity(align(capacity)),
+        _requested(false),
+        _head(0),
+        _used(0),
+        _uploads(),
+        _ready(),
+        _batches(),
+        _next_batch(1),
+        _completed_batch(0) {
+
+    }
+
+    TextureStreamer(const TextureStreamer& other) = delete;
+    TextureStreamer& operator=(const TextureStreamer& other) = delete;
+
+    ~TextureStreamer() {
+        destroy();
+    }
+
+    // Creates and maps the buffer, which flush() otherwise does after the
+    // first write(). Must be called on the GL thread.
+    void create() {
+        if (_id != 0) {
+            return;
+        }
+
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT |
+                           GL_MAP_COHERENT_BIT;
+        glCreateBuffers(1, &_id);
+        glNamedBufferStorage(_id, (GLsizeiptr) _capacity, nullptr, flags);
+        uint8_t* mapped = (uint8_t*) glMapNamedBufferRange(
+                              _id, 0, (GLsizeiptr) _capacity, flags);
+        if (mapped == nullptr) {
+            ERROR("Could not map the texture stream buffer! Error: " <<
+                  glGetError());
+            exit(1);
+        }
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        _mapped = mapped;
+    }
+
+    // Frees the buffer and drops every queued update. Must be called before
+    // the GL context is destroyed if the streamer outlives it.
+    void destroy() {
+        for (Batch& batch : _batches) {
+            glDeleteSync(batch.fence);
+        }
+        _batches.clear();
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        _uploads.clear();
+        _requested = false;
+        _head = 0;
+        _used = 0;
+        if (_id != 0) {
+            glUnmapNamedBuffer(_id);
+            glDeleteBuffers(1, &_id);
+            GLState::forget_buffer(_id);
+            _id = 0;
+            _mapped = nullptr;
+        }
+    }
+
+    // Queues an update of `width` x `height` pixels at (`x`, `y`) of
+    // `texture`'s mip `level`. `format` and `type` describe `data` as for
+    // glTextureSubImage2D; rows are `pitch` bytes apart, or tightly packed
+    // if `pitch` is 0. May be called from any thread. Returns false, without
+    // queueing anything, if the ring has no room for the update right now.
+    bool write(const Texture& texture,
+               const GLint& x,
+               const GLint& y,
+               const GLsizei& width,
+               const GLsizei& height,
+               const GLenum& format,
+               const GLenum& type,
+               const void* data,
+               const size_t& pitch = 0,
+               const GLint& level = 0) {
+        const size_t row_bytes = (size_t) width * pixel_size(format, type);
+        const size_t num_bytes = row_bytes * height;
+        if (align(num_bytes) > _capacity) {
+            throw std::runtime_error("Texture update is larger than the "
+                                     "stream buffer");
+        }
+
+        Upload* upload;
+        uint8_t* dst;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (_mapped == nullptr) {
+                _requested = true;
+                return false;
+            }
+            upload = reserve(align(num_bytes));
+            if (upload == nullptr) {
+                return false;
+            }
+            *upload = Upload({
+                texture.id, level, x, y, width, height, format, type,
+                upload->offset, upload->size, false, 0
+            });
+            dst = _mapped + upload->offset;
+        }
+
+        // Copying happens outside the lock so writers do not serialize;
+        // flush() skips the update until it is marked as written
+        const uint8_t* src = (const uint8_t*) data;
+        if (pitch == 0 || pitch == row_bytes) {
+            std::memcpy(dst, src, num_bytes);
+        } else {
+            for (GLsizei row = 0; row < height; row++) {
+                std::memcpy(dst + row * row_bytes, src + row * pitch,
+                            row_bytes);
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        upload->written = true;
+        return true;
+    }
+
+    // Issues every written update and fences them. Must be called on the
+    // GL thread. Returns the number of bytes that were issued.
+    size_t flush() {
+        if (_id == 0) {
+            bool requested;
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                requested = _requested;
+            }
+            if (requested) {
+                create();
+            }
+            return 0;
+        }
+        retire();
+
+        const uint64_t batch = _next_batch;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            for (Upload& upload : _uploads) {
+                if (upload.written && upload.batch == 0) {
+                    upload.batch = batch;
+                    _ready.push_back(upload);
+                }
+            }
+        }
+        if (_ready.empty()) {
+            return 0;
+        }
+
+        size_t bytes = 0;
+        GLState::bind_buffer(GL_PIXEL_UNPACK_BUFFER, _id);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        for (const Upload& upload : _ready) {
+            glTextureSubImage2D(upload.texture, upload.level,
+                                upload.x, upload.y,
+                                upload.width, upload.height,
+                                upload.format, upload.type,
+                                (const void*)(uintptr_t) upload.offset);
+            bytes += upload.size;
+        }
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        // Client memory uploads elsewhere must not read from the ring
+        GLState::unbind_buffer(GL_PIXEL_UNPACK_BUFFER, _id);
+
+        _batches.push_back(Batch({
+            batch, glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0)
+        }));
+        _next_batch++;
+        _ready.clear();
+        return bytes;
+    }
+
+    // Bytes of the ring held by updates that are queued or still being
+    // read by the GPU
+    size_t bytes_used() {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _used;
+    }
+
+    size_t capacity() const {
+        return _capacity;
+    }
+
+    bool is_created() const {
+        return _id != 0;
+    }
+
+  private:
+    // A queued or in-flight update. `size` includes any padding skipped to
+    // wrap around the end of the ring. `batch` is 0 until flush() issues it.
+    typedef struct {
+        GLuint texture;
+        GLint level;
+        GLint x;
+        GLint y;
+        GLsizei width;
+        GLsizei height;
+        GLenum format;
+        GLenum type;
+        size_t offset;
+        size_t size;
+        bool written;
+        uint64_t batch;
+    } Upload;
+
+    typedef struct {
+        uint64_t id;
+        GLsync fence;
+    } Batch;
+
+    // Carves `num_bytes` out of the free part of the ring, which starts at
+    // the head. Updates never straddle the end of the buffer. References
+    // into a deque survive push_back and pop_front, and an update is only
+    // popped once written, so the returned pointer stays valid for write().
+    // Called with the mutex held.
+    Upload* reserve(const size_t& num_bytes) {
+        if (_used == 0) {
+            _head = 0;
+        }
+        size_t padding = 0;
+        if (_head + num_bytes > _capacity) {
+            padding = _capacity - _head;
+        }
+        if (padding + num_bytes > _capacity - _used) {
+            return nullptr;
+        }
+
+        size_t offset = (padding > 0) ? 0 : _head;
+        _head = (offset + num_bytes) % _capacity;
+        _used += padding + num_bytes;
+
+        Upload upload;
+        upload.offset = offset;
+        upload.size = padding + num_bytes;
+        _uploads.push_back(upload);
+        return &_uploads.back();
+    }
+
+    // Frees the space of updates whose fence has signaled. Fences signal in
+    // the order they were placed, so polling stops at the first pending one.
+    void retire() {
+        while (!_batches.empty()) {
+            GLenum status = glClientWaitSync(_batches.front().fence, 0, 0);
+            if (status != GL_ALREADY_SIGNALED &&
+                    status != GL_CONDITION_SATISFIED) {
+                if (status == GL_WAIT_FAILED) {
+                    ERROR("Polling a texture stream fence failed!");
+                }
+                break;
+            }
+            _completed_batch = _batches.front().id;
+            glDeleteSync(_batches.front().fence);
+            _batches.pop_front();
+        }
+
+        // Space is released in the order it was reserved
+        std::lock_guard<std::mutex> lock(_mutex);
+        while (!_uploads.empty() && _uploads.front().batch != 0 &&
+                _uploads.front().batch <= _completed_batch) {
+            _used -= _uploads.front().size;
+            _uploads.pop_front();
+        }
+    }
+
+    static size_t align(const size_t& num_bytes) {
+        return (num_bytes + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+    }
+
+    GLuint _id;
+    uint8_t* _mapped;
+    size_t _capacity;
+    // Set by a write() that found no buffer
+    bool _requested;
+    size_t _head;
+    size_t _used;
+
+    // Updates in the order their space was reserved
+    std::deque<Upload> _uploads;
+    // Reused by flush() so issuing updates does not allocate
+    std::vector<Upload> _ready;
+
+    // Only touched on the GL thread
+    std::deque<Batch> _batches;
+    uint64_t _next_batch;
+    uint64_t _completed_batch;
+
+    std::mutex _mutex;
+
+    // Keeps every update aligned for any pixel type, and to a cache line
+    constexpr static size_t ALIGNMENT = 64;
+};
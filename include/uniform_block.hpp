@@ -0,0 +1,295 @@
+//
+// ChameleonGL - A small framework for OpenGL.
+// Copyright (C) 2012-2017 Srinivas Kaza
+//
+// This file is part of ChameleonGL.
+//
+// ChameleonGL is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ChameleonGL is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ChameleonGL.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#pragma once
+
+#include <algorithm>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <cstdint>
+
+// OpenGL / glew Headers
+#define GL3_PROTOTYPES 1
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+#include "util.hpp"
+
+// Binding point reserved for the chml_frame block, which holds the uniforms
+// shared by every program and is uploaded once per frame
+const std::string FRAME_BLOCK_NAME = "chml_frame";
+constexpr GLuint FRAME_BLOCK_BINDING = 0;
+
+// std140 layout of the chml_frame block
+typedef struct {
+    glm::mat4 chml_view;
+    glm::mat4 chml_projection;
+    glm::mat4 chml_inverse_view_projection;
+    glm::vec4 chml_viewport;
+    glm::vec3 chml_origin;
+    GLfloat chml_near;
+} FrameUniformBlock;
+
+// A slice of a uniform buffer holding one block's worth of data. `data`
+// points at the mapped bytes of the slice while it is being written.
+typedef struct {
+    GLuint buffer;
+    GLintptr offset;
+    GLsizeiptr size;
+    uint8_t* data;
+} UniformBufferRange;
+
+typedef struct {
+    std::string name;
+    GLenum type;
+    GLint offset;
+    GLint array_size;
+    GLint array_stride;
+    GLint matrix_stride;
+} UniformBlockMember;
+
+// The layout of a uniform block as reported by the linked program. Values
+// are written into a block's bytes through the member offset table, so the
+// same code works for std140, shared and packed blocks.
+class UniformBlockLayout {
+  public:
+    UniformBlockLayout() :
+        name(),
+        index(GL_INVALID_INDEX),
+        binding(0),
+        size(0),
+        members() {
+
+    }
+
+    UniformBlockLayout(const std::string& name,
+                       const GLint& size,
+                       std::vector<UniformBlockMember> members) :
+        name(name),
+        index(GL_INVALID_INDEX),
+        binding(0),
+        size(size),
+        members(members) {
+        std::sort(this->members.begin(), this->members.end(),
+                  [](const UniformBlockMember& a,
+                     const UniformBlockMember& b) {
+                      return a.name < b.name;
+                  });
+    }
+
+    static UniformBlockLayout reflect(const GLuint& program,
+                                      const GLuint& index) {
+        const GLenum block_properties[] = {
+            GL_NAME_LENGTH, GL_BUFFER_DATA_SIZE, GL_NUM_ACTIVE_VARIABLES,
+            GL_BUFFER_BINDING
+        };
+        GLint block_values[4];
+        glGetProgramResourceiv(program, GL_UNIFORM_BLOCK, index,
+                               4, block_properties, 4, nullptr, block_values);
+
+        std::vector<GLint> variables(block_values[2]);
+        const GLenum active_variables = GL_ACTIVE_VARIABLES;
+        if (!variables.empty()) {
+            glGetProgramResourceiv(program, GL_UNIFORM_BLOCK, index,
+                                   1, &active_variables,
+                                   (GLsizei) variables.size(), nullptr,
+                                   variables.data());
+        }
+
+        const GLenum member_properties[] = {
+            GL_NAME_LENGTH, GL_TYPE, GL_OFFSET,
+            GL_ARRAY_SIZE, GL_ARRAY_STRIDE, GL_MATRIX_STRIDE
+        };
+        std::vector<UniformBlockMember> members;
+        for (GLint variable : variables) {
+            GLint values[6];
+            glGetProgramResourceiv(program, GL_UNIFORM, variable,
+                                   6, member_properties, 6, nullptr, values);
+            members.push_back(UniformBlockMember({
+                resource_name(program, GL_UNIFORM, variable, values[0]),
+                (GLenum) values[1], values[2],
+                values[3], values[4], values[5]
+            }));
+        }
+
+        UniformBlockLayout layout(
+            resource_name(program, GL_UNIFORM_BLOCK, index, block_values[0]),
+            block_values[1], members);
+        layout.index = index;
+        layout.binding = (GLuint) block_values[3];
+        return layout;
+    }
+
+    const UniformBlockMember* find(const std::string& member) const {
+        auto it = std::lower_bound(members.begin(), members.end(), member,
+                                   [](const UniformBlockMember& a,
+                                      const std::string& b) {
+                                       return a.name < b;
+                                   });
+        if (it == members.end() || it->name != member) {
+            return nullptr;
+        }
+        return &(*it);
+    }
+
+    // Writes `value` into `block` at the offset of `member`. Array members
+    // are addressed by their name without a subscript plus `element`.
+    template <typename T>
+    bool write(uint8_t* block,
+               const std::string& member,
+               const T& value,
+               const GLint& element = 0) const {
+        const UniformBlockMember* m = find(member);
+        if (m == nullptr) {
+            ERROR("Uniform block " << name << " has no member " << member);
+            return false;
+        }
+        if (m->type != gl_type(value)) {
+            ERROR("Uniform block member " << name << "." << member <<
+                  " does not match the type of the value written to it");
+            return false;
+        }
+        if (element < 0 || element >= std::max(m->array_size, 1)) {
+            ERROR("Uniform block member " << name << "." << member <<
+                  " has no element " << element);
+            return false;
+        }
+
+        copy_value(block + m->offset + element * m->array_stride,
+                   m->matrix_stride, value);
+        return true;
+    }
+
+    template <typename T>
+    bool write(const UniformBufferRange& range,
+               const std::string& member,
+               const T& value,
+               const GLint& element = 0) const {
+        return write(range.data, member, value, element);
+    }
+
+    std::string name;
+    GLuint index;
+    GLuint binding;
+    GLint size;
+    // Sorted by name
+    std::vector<UniformBlockMember> members;
+
+  private:
+    static std::string resource_name(const GLuint& program,
+                                     const GLenum& interface,
+                                     const GLuint& index,
+                                     const GLint& length) {
+        std::string str(std::max(length, 1), '\0');
+        GLsizei written = 0;
+        glGetProgramResourceName(program, interface, index,
+                                 (GLsizei) str.size(), &written, &str[0]);
+        str.resize(written);
+
+        // Arrays are reported as their first element
+        if (str.size() > 3 && str.compare(str.size() - 3, 3, "[0]") == 0) {
+            str.resize(str.size() - 3);
+        }
+        return str;
+    }
+
+    template <typename T>
+    static GLenum gl_type(const T& value) {
+        return GL_NONE;
+    }
+
+    static GLenum gl_type(const GLfloat& value) {
+        return GL_FLOAT;
+    }
+
+    static GLenum gl_type(const glm::vec2& value) {
+        return GL_FLOAT_VEC2;
+    }
+
+    static GLenum gl_type(const glm::vec3& value) {
+        return GL_FLOAT_VEC3;
+    }
+
+    static GLenum gl_type(const glm::vec4& value) {
+        return GL_FLOAT_VEC4;
+    }
+
+    static GLenum gl_type(const GLint& value) {
+        return GL_INT;
+    }
+
+    static GLenum gl_type(const glm::ivec2& value) {
+        return GL_INT_VEC2;
+    }
+
+    static GLenum gl_type(const glm::ivec3& value) {
+        return GL_INT_VEC3;
+    }
+
+    static GLenum gl_type(const glm::ivec4& value) {
+        return GL_INT_VEC4;
+    }
+
+    static GLenum gl_type(const glm::mat2& value) {
+        return GL_FLOAT_MAT2;
+    }
+
+    static GLenum gl_type(const glm::mat3& value) {
+        return GL_FLOAT_MAT3;
+    }
+
+    static GLenum gl_type(const glm::mat4& value) {
+        return GL_FLOAT_MAT4;
+    }
+
+    template <typename T>
+    static void copy_value(uint8_t* dst,
+                           const GLint& matrix_stride,
+                           const T& value) {
+        std::memcpy(dst, &value, sizeof(value));
+    }
+
+    // Matrix columns are padded out to the block's matrix stride
+    static void copy_value(uint8_t* dst,
+                           const GLint& matrix_stride,
+                           const glm::mat2& value) {
+        for (int c = 0; c < 2; c++) {
+            std::memcpy(dst + c * matrix_stride, &value[c], sizeof(value[c]));
+        }
+    }
+
+    static void copy_value(uint8_t* dst,
+                           const GLint& matrix_stride,
+                           const glm::mat3& value) {
+        for (int c = 0; c < 3; c++) {
+            std::memcpy(dst + c * matrix_stride, &value[c], sizeof(value[c]));
+        }
+    }
+
+    static void copy_value(uint8_t* dst,
+                           const GLint& matrix_stride,
+                           const glm::mat4& value) {
+        for (int c = 0; c < 4; c++) {
+            std::memcpy(dst + c * matrix_stride, &value[c], sizeof(value[c]));
+        }
+    }
+};
@@ -18,72 +18,366 @@
 // along with ChameleonGL.  If not, see <http://www.gnu.org/licenses/>.
 //
 
+
 #pragma once
 
 #include <iostream>
-#include <unordered_map>
-#include <functional>
+#include <vector>
+#include <string>
 #include <memory>
+#include <cstring>
+#include <cstdint>
+
+#include <glm/glm.hpp>
 
 #include "util.hpp"
 #include "opengl_utils.hpp"
 #include "gl_context.hpp"
 
+enum UniformType : uint8_t {
+    UNIFORM_FLOAT,
+    UNIFORM_VEC2,
+    UNIFORM_VEC3,
+    UNIFORM_VEC4,
+    UNIFORM_INT,
+    UNIFORM_IVEC2,
+    UNIFORM_IVEC3,
+    UNIFORM_IVEC4,
+    UNIFORM_MAT2,
+    UNIFORM_MAT3,
+    UNIFORM_MAT4,
+    UNIFORM_TEXTURE
+};
+
+// Values live in one contiguous byte buffer, tagged by type, instead of one
+// closure per uniform. The first time a map is applied to a Program its
+// names are resolved to locations, and every later apply to that link of
+// the Program is a single pass of glProgramUniform* calls over those
+// locations. Locations are kept for the last few programs the map was
+// applied to, so a map shared between programs (like the DrawCommand
+// globals) stays resolved.
+//
+// Copies of a UniformMap share their storage until one of them is modified,
+// so handing the same map to many commands does not copy it. An empty map
+// allocates nothing. The resolved locations are shared by the copies too;
+// they are only touched by apply(), which like any GL call belongs on the
+// GL thread, and are not carried into the copy a modified map makes.
 class UniformMap {
   public:
     UniformMap() :
-        _map(new std::unordered_map <std::string,
-             std::function<void(Program&)>>),
-        _texture_map(new std::unordered_map <std::string, Texture>) {
+        _storage() {
 
     }
 
-    UniformMap(const UniformMap& other) {
-        auto old_map = *(other._map);
-        auto map_copy = new std::unordered_map
-        <std::string, std::function<void(Program&)>> (old_map);
-        this->_map = std::unique_ptr <
-                     std::unordered_map<std::string,
-                     std::function<void(Program&)>>
-                     > (map_copy);
+    template <typename T>
+    void set(const UniformName& key, T value) {
+        ERROR("Don't know what to do with a uniform like " <<
+              value << " named " << key);
+    }
 
-        auto old_texture_map = *(other._texture_map);
-        auto texture_map_copy =
-            new std::unordered_map<std::string, Texture> (old_texture_map);
-        this->_texture_map =
-            std::unique_ptr <std::unordered_map<std::string, Texture>>
-            (texture_map_copy);
+    void set(const UniformName& key, const GLfloat& value) {
+        store(key, UNIFORM_FLOAT, &value, sizeof(value));
     }
 
-    template <typename T>
-    void set(const std::string& key, T value) {
-        (*_map)[key] = [key, value](Program & program) {
-            program.set_uniform(key, value);
-        };
+    void set(const UniformName& key, const glm::vec2& value) {
+        store(key, UNIFORM_VEC2, &value, sizeof(value));
+    }
+
+    void set(const UniformName& key, const glm::vec3& value) {
+        store(key, UNIFORM_VEC3, &value, sizeof(value));
+    }
+
+    void set(const UniformName& key, const glm::vec4& value) {
+        store(key, UNIFORM_VEC4, &value, sizeof(value));
+    }
+
+    void set(const UniformName& key, float value[4]) {
+        store(key, UNIFORM_VEC4, value, 4 * sizeof(float));
+    }
+
+    void set(const UniformName& key, const GLint& value) {
+        store(key, UNIFORM_INT, &value, sizeof(value));
+    }
+
+    void set(const UniformName& key, const glm::ivec2& value) {
+        store(key, UNIFORM_IVEC2, &value, sizeof(value));
+    }
+
+    void set(const UniformName& key, const glm::ivec3& value) {
+        store(key, UNIFORM_IVEC3, &value, sizeof(value));
+    }
+
+    void set(const UniformName& key, const glm::ivec4& value) {
+        store(key, UNIFORM_IVEC4, &value, sizeof(value));
+    }
+
+    void set(const UniformName& key, int value[4]) {
+        store(key, UNIFORM_IVEC4, value, 4 * sizeof(int));
     }
 
-    void set(const std::string& key, Texture value) {
-        (*_map)[key] = [key, value](Program & program) {
-            program.set_uniform(key, value);
-        };
+    void set(const UniformName& key, const glm::mat2& value) {
+        store(key, UNIFORM_MAT2, &value, sizeof(value));
+    }
+
+    void set(const UniformName& key, const glm::mat3& value) {
+        store(key, UNIFORM_MAT3, &value, sizeof(value));
+    }
 
-        (*_texture_map)[key] = value;
+    void set(const UniformName& key, const glm::mat4& value) {
+        store(key, UNIFORM_MAT4, &value, sizeof(value));
+    }
+
+    void set(const UniformName& key, const Texture& value) {
+        detach();
+        Entry* entry = find(key);
+        if (entry != nullptr && entry->type == UNIFORM_TEXTURE) {
+            _storage->textures[entry->offset] = value;
+            return;
+        }
+
+        uint32_t index = (uint32_t) _storage->textures.size();
+        _storage->textures.push_back(value);
+        if (entry != nullptr) {
+            entry->type = UNIFORM_TEXTURE;
+            entry->offset = index;
+        } else {
+            _storage->entries.push_back(make_entry(key, UNIFORM_TEXTURE,
+                                                   index));
+            _storage->resolved.clear();
+        }
     }
 
-    void apply(Program& program) {
-        for (auto& pair : *_map) {
-            if (_texture_map->count(pair.first)) {
-                _texture_map->at(pair.first).bind();
+    // Uniforms the program does not have are an error unless `validate` is
+    // false, in which case they are skipped
+    void apply(Program& program, const bool& validate = true) {
+        if (!_storage) {
+            return;
+        }
+
+        const std::vector<GLint>& locations = resolve(program, validate);
+        const std::vector<Entry>& entries = _storage->entries;
+        const uint8_t* data = _storage->data.data();
+
+        for (size_t i = 0; i < entries.size(); i++) {
+            const Entry& entry = entries[i];
+            if (locations[i] == -1) {
+                continue;
             }
-            pair.second(program);
+            if (entry.type == UNIFORM_TEXTURE) {
+                // The unit is not stored on the shared Texture, which other
+                // copies of this map may be reading
+                GLint unit = GLContext::get_texturing_unit();
+                GLState::bind_texture_unit(
+                    unit, _storage->textures[entry.offset].id);
+                glProgramUniform1i(program.id, locations[i], unit);
+            } else {
+                apply_value(program.id, locations[i], entry.type,
+                            data + entry.offset);
+            }
+        }
+    }
+
+    // Identifies the set of textures bound by this map, independent of the
+    // order they were set in
+    uint64_t texture_set_hash() const {
+        uint64_t h = 0;
+        if (!_storage) {
+            return h;
         }
+
+        for (const Texture& texture : _storage->textures) {
+            uint64_t id = texture.id;
+            id = (id ^ (id >> 16)) * 0x45d9f3bULL;
+            id = (id ^ (id >> 16)) * 0x45d9f3bULL;
+            h += id ^ (id >> 16);
+        }
+        return h;
+    }
+
+    size_t size() const {
+        return _storage ? _storage->entries.size() : 0;
     }
 
     void post_render() {
         GLContext::clear_texturing_unit();
     }
+
   private:
-    std::unique_ptr < std::unordered_map <
-    std::string, std::function<void(Program&) >>> _map;
-    std::unique_ptr < std::unordered_map <std::string, Texture>> _texture_map;
+    typedef struct {
+        NameId id;
+        const char* literal_name;
+        // Only set for names that are not literals
+        std::string name;
+        UniformType type;
+        // Byte offset into data, or index into textures
+        uint32_t offset;
+    } Entry;
+
+    // Locations of every entry, resolved for the program link
+    // `link_serial` (see Program::get_link_serial)
+    typedef struct {
+        uint64_t link_serial;
+        std::vector<GLint> locations;
+    } ResolvedLocations;
+
+    struct Storage {
+        Storage() :
+            entries(),
+            data(),
+            textures(),
+            resolved() {
+
+        }
+
+        // Copies are made to be modified, so they resolve again anyway
+        Storage(const Storage& other) :
+            entries(other.entries),
+            data(other.data),
+            textures(other.textures),
+            resolved() {
+
+        }
+
+        std::vector<Entry> entries;
+        std::vector<uint8_t> data;
+        std::vector<Texture> textures;
+
+        // Most recently resolved program last. Only used on the GL thread.
+        std::vector<ResolvedLocations> resolved;
+    };
+
+    // Literal names are kept by pointer, and other names are copied
+    static Entry make_entry(const UniformName& key,
+                            const UniformType& type,
+                            const uint32_t& offset) {
+        Entry entry;
+        entry.id = key.id;
+        entry.literal_name = key.is_literal ? key.name : nullptr;
+        if (!key.is_literal && key.name != nullptr) {
+            entry.name = key.name;
+        }
+        entry.type = type;
+        entry.offset = offset;
+        return entry;
+    }
+
+    static UniformName entry_name(const Entry& entry) {
+        if (entry.literal_name != nullptr) {
+            return UniformName(entry.id, entry.literal_name, true);
+        }
+        return UniformName(entry.id, entry.name.c_str(), false);
+    }
+
+    Entry* find(const UniformName& key) {
+        for (Entry& entry : _storage->entries) {
+            if (entry.id == key.id) {
+                return &entry;
+            }
+        }
+        return nullptr;
+    }
+
+    void store(const UniformName& key,
+               const UniformType& type,
+               const void* value,
+               const size_t& num_bytes) {
+        detach();
+        Entry* entry = find(key);
+        if (entry != nullptr && entry->type == type) {
+            std::memcpy(&_storage->data[entry->offset], value, num_bytes);
+            return;
+        }
+
+        uint32_t offset = (uint32_t) _storage->data.size();
+        _storage->data.resize(offset + num_bytes);
+        std::memcpy(&_storage->data[offset], value, num_bytes);
+        if (entry != nullptr) {
+            entry->type = type;
+            entry->offset = offset;
+        } else {
+            _storage->entries.push_back(make_entry(key, type, offset));
+            _storage->resolved.clear();
+        }
+    }
+
+    const std::vector<GLint>& resolve(Program& program,
+                                      const bool& validate) {
+        std::vector<ResolvedLocations>& resolved = _storage->resolved;
+        const uint64_t serial = program.get_link_serial();
+        for (size_t i = resolved.size(); i-- > 0;) {
+            if (resolved[i].link_serial == serial) {
+                return resolved[i].locations;
+            }
+        }
+
+        if (resolved.size() == MAX_RESOLVED_PROGRAMS) {
+            resolved.erase(resolved.begin());
+        }
+        resolved.push_back(ResolvedLocations({serial, {}}));
+        std::vector<GLint>& locations = resolved.back().locations;
+        locations.reserve(_storage->entries.size());
+        for (const Entry& entry : _storage->entries) {
+            locations.push_back(program.get_uniform_location(
+                                    entry_name(entry), validate));
+        }
+        return locations;
+    }
+
+    static void apply_value(const GLuint& program,
+                            const GLint& location,
+                            const UniformType& type,
+                            const uint8_t* value) {
+        const GLfloat* f = (const GLfloat*) value;
+        const GLint* i = (const GLint*) value;
+        switch (type) {
+            case UNIFORM_FLOAT:
+                glProgramUniform1fv(program, location, 1, f);
+                break;
+            case UNIFORM_VEC2:
+                glProgramUniform2fv(program, location, 1, f);
+                break;
+            case UNIFORM_VEC3:
+                glProgramUniform3fv(program, location, 1, f);
+                break;
+            case UNIFORM_VEC4:
+                glProgramUniform4fv(program, location, 1, f);
+                break;
+            case UNIFORM_INT:
+                glProgramUniform1iv(program, location, 1, i);
+                break;
+            case UNIFORM_IVEC2:
+                glProgramUniform2iv(program, location, 1, i);
+                break;
+            case UNIFORM_IVEC3:
+                glProgramUniform3iv(program, location, 1, i);
+                break;
+            case UNIFORM_IVEC4:
+                glProgramUniform4iv(program, location, 1, i);
+                break;
+            case UNIFORM_MAT2:
+                glProgramUniformMatrix2fv(program, location, 1, GL_FALSE, f);
+                break;
+            case UNIFORM_MAT3:
+                glProgramUniformMatrix3fv(program, location, 1, GL_FALSE, f);
+                break;
+            case UNIFORM_MAT4:
+                glProgramUniformMatrix4fv(program, location, 1, GL_FALSE, f);
+                break;
+            case UNIFORM_TEXTURE:
+                break;
+        }
+    }
+
+    // Gives this map its own storage before it is modified
+    void detach() {
+        if (!_storage) {
+            _storage = std::make_shared<Storage>();
+        } else if (_storage.use_count() > 1) {
+            _storage = std::make_shared<Storage>(*_storage);
+        }
+    }
+
+    constexpr static size_t MAX_RESOLVED_PROGRAMS = 8;
+
+    std::shared_ptr<Storage> _storage;
 };
@@ -0,0 +1,198 @@
+//
+// ChameleonGL - A small framework for OpenGL.
+// Copyright (C) 2012-2017 Srinivas Kaza
+//
+// This file is part of ChameleonGL.
+//
+// ChameleonGL is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ChameleonGL is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ChameleonGL.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
+#include <cstring>
+#include <cstdint>
+#include <stdexcept>
+
+// OpenGL / glew Headers
+#define GL3_PROTOTYPES 1
+#include <GL/glew.h>
+
+#include "util.hpp"
+#include "gl_state.hpp"
+#include "uniform_block.hpp"
+
+// One persistently mapped uniform buffer split into a region per frame in
+// flight. Uniform blocks for a frame are sub-allocated from that frame's
+// region with a single atomic add, so any recording thread may allocate,
+// and writes go straight into the mapped memory. A fence placed at the end
+// of each frame keeps a region from being overwritten until the GPU has
+// finished reading it.
+class UniformRingBuffer {
+  public:
+    explicit UniformRingBuffer(const size_t& frame_size = 1 << 20,
+                               const size_t& frames = 3) :
+        _id(0),
+        _mapped(nullptr),
+        _alignment(256),
+        _frame_size(frame_size),
+        _frame(0),
+        _head(0),
+        _fences(frames, nullptr) {
+
+    }
+
+    UniformRingBuffer(const UniformRingBuffer& other) = delete;
+    UniformRingBuffer& operator=(const UniformRingBuffer& other) = delete;
+
+    ~UniformRingBuffer() {
+        destroy();
+    }
+
+    // Frees the buffer and its fences. Must be called before the GL context
+    // is destroyed if the ring buffer outlives it.
+    void destroy() {
+        for (GLsync& fence : _fences) {
+            if (fence != nullptr) {
+                glDeleteSync(fence);
+                fence = nullptr;
+            }
+        }
+        if (_id != 0) {
+            glUnmapNamedBuffer(_id);
+            glDeleteBuffers(1, &_id);
+            GLState::forget_buffer(_id);
+            _id = 0;
+            _mapped = nullptr;
+        }
+    }
+
+    // Waits until the GPU is done with the region used `frames` frames ago
+    // and starts allocating from it. Must be called on the thread owning
+    // the GL context, which is also where the buffer is created.
+    void begin_frame() {
+        if (_id == 0) {
+            create();
+        }
+
+        GLsync& fence = _fences[region()];
+        if (fence != nullptr) {
+            GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+            while (true) {
+                GLenum status = glClientWaitSync(fence, flags, WAIT_TIMEOUT);
+                if (status == GL_ALREADY_SIGNALED ||
+                        status == GL_CONDITION_SATISFIED) {
+                    break;
+                }
+                if (status == GL_WAIT_FAILED) {
+                    ERROR("Waiting on a uniform buffer fence failed!");
+                    break;
+                }
+                flags = 0;
+            }
+            glDeleteSync(fence);
+            fence = nullptr;
+        }
+        _head.store(0);
+    }
+
+    // Fences the commands that read this frame's region
+    void end_frame() {
+        _fences[region()] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        _frame++;
+    }
+
+    // Reserves `num_bytes` of this frame's region. The range is only valid
+    // until the end of the frame.
+    UniformBufferRange allocate(const size_t& num_bytes) {
+        size_t aligned = align(num_bytes);
+        size_t offset = _head.fetch_add(aligned);
+        if (offset + aligned > _frame_size) {
+            throw std::runtime_error("Uniform ring buffer is out of space "
+                                     "for this frame");
+        }
+
+        offset += region() * _frame_size;
+        UniformBufferRange range;
+        range.buffer = _id;
+        range.offset = (GLintptr) offset;
+        range.size = (GLsizeiptr) num_bytes;
+        range.data = _mapped + offset;
+        return range;
+    }
+
+    // Copies a struct laid out to match the block (e.g. std140) into the
+    // frame's region
+    template <typename T>
+    UniformBufferRange push(const T& value) {
+        UniformBufferRange range = allocate(sizeof(T));
+        std::memcpy(range.data, &value, sizeof(T));
+        return range;
+    }
+
+    static void bind(const UniformBufferRange& range, const GLuint& binding) {
+        GLState::bind_buffer_range(GL_UNIFORM_BUFFER, binding, range.buffer,
+                                   range.offset, range.size);
+    }
+
+    size_t bytes_used() const {
+        return std::min(_head.load(), _frame_size);
+    }
+
+    size_t frame_size() const {
+        return _frame_size;
+    }
+
+  private:
+    void create() {
+        GLint alignment = 0;
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+        if (alignment > 0) {
+            _alignment = (size_t) alignment;
+        }
+        _frame_size = align(_frame_size);
+
+        GLsizeiptr total = (GLsizeiptr) (_frame_size * _fences.size());
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT |
+                           GL_MAP_COHERENT_BIT;
+        glCreateBuffers(1, &_id);
+        glNamedBufferStorage(_id, total, nullptr, flags);
+        _mapped = (uint8_t*) glMapNamedBufferRange(_id, 0, total, flags);
+        if (_mapped == nullptr) {
+            ERROR("Could not map the uniform ring buffer! Error: " <<
+                  glGetError());
+            exit(1);
+        }
+    }
+
+    size_t align(const size_t& num_bytes) const {
+        return (num_bytes + _alignment - 1) / _alignment * _alignment;
+    }
+
+    size_t region() const {
+        return _frame % _fences.size();
+    }
+
+    GLuint _id;
+    uint8_t* _mapped;
+    size_t _alignment;
+    size_t _frame_size;
+    size_t _frame;
+    std::atomic<size_t> _head;
+    std::vector<GLsync> _fences;
+
+    constexpr static GLuint64 WAIT_TIMEOUT = 1000000000;
+};
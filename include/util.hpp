@@ -36,6 +36,17 @@ const std::string reset_code("\033[0m");
 #define DEBUG(a)         std::cout << a << "\n"
 #define ERROR(a)         std::cerr << red << a << reset_code << "\n"
 
+// Messages that are too frequent for DEBUG, e.g. progress while loading,
+// are only printed when built with -DCHML_LOG_LEVEL=2
+#ifndef CHML_LOG_LEVEL
+#define CHML_LOG_LEVEL   1
+#endif
+#if CHML_LOG_LEVEL >= 2
+#define VERBOSE(a)       DEBUG(a)
+#else
+#define VERBOSE(a)
+#endif
+
 /**
  * Returns the string representation of an object,
  * assuming that it has defined the stream operator
@@ -50,7 +61,7 @@ inline std::string TOS(const T& s) {
     return a.str();
 }
 
-std::string read_file(const std::string& filename) {
+inline std::string read_file(const std::string& filename) {
     std::ifstream t(filename);
     std::string str((std::istreambuf_iterator<char>(t)),
                     std::istreambuf_iterator<char>());
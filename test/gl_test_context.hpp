@@ -0,0 +1,63 @@
+//
+// ChameleonGL - A small framework for OpenGL.
+// Copyright (C) 2012-2017 Srinivas Kaza
+//
+// This file is part of ChameleonGL.
+//
+// ChameleonGL is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ChameleonGL is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ChameleonGL.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#pragma once
+
+#include <string>
+#include <unordered_map>
+
+#include "null_event_handler.hpp"
+#include "graphics_context.hpp"
+
+#ifdef CHML_HAVE_EGL
+
+// A small headless GraphicsContext for tests that need GL. start() runs
+// `frames` frames before returning.
+class GLTestContext {
+  public:
+    explicit GLTestContext(const int& width = 64,
+                           const int& height = 64,
+                           const int& frames = 1) :
+        handler(),
+        width(width),
+        height(height),
+        frames(frames),
+        headless(true),
+        options({
+            {"width", &this->width},
+            {"height", &this->height},
+            {"frames", &this->frames},
+            {"headless", &this->headless}
+        }),
+        context(handler, options) {
+
+    }
+
+    NullEventHandler handler;
+    int width;
+    int height;
+    int frames;
+    bool headless;
+    std::unordered_map<std::string, void*> options;
+    GraphicsContext context;
+};
+
+#endif
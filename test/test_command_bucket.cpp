@@ -0,0 +1,151 @@
+//
+// ChameleonGL - A small framework for OpenGL.
+// Copyright (C) 2012-2017 Srinivas Kaza
+//
+// This file is part of ChameleonGL.
+//
+// ChameleonGL is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ChameleonGL is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ChameleonGL.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include <vector>
+#include <random>
+#include <algorithm>
+
+#include "catch.hpp"
+
+#include "command_bucket.hpp"
+#include "draw_command.hpp"
+#include "clear_command.hpp"
+#include "compute_command.hpp"
+#include "readback_command.hpp"
+#include "dummy_framebuffer.hpp"
+#include "gl_test_context.hpp"
+
+TEST_CASE("command bucket keys sort draws", "[command_bucket]") {
+    SECTION("radix sort matches a stable sort") {
+        std::mt19937_64 rng(1234);
+        std::vector<CommandBucket::KeyIndex> entries;
+        for (uint32_t i = 0; i < 10000; i++) {
+            // Few distinct keys, so that stability actually matters
+            uint64_t key = rng() % 64;
+            key = (key << 40) | (key * 7 % 5);
+            entries.push_back(CommandBucket::KeyIndex(key, i));
+        }
+
+        std::vector<CommandBucket::KeyIndex> expected(entries);
+        std::stable_sort(expected.begin(), expected.end(),
+                         [](const CommandBucket::KeyIndex & a,
+        const CommandBucket::KeyIndex & b) {
+            return a.first < b.first;
+        });
+
+        std::vector<CommandBucket::KeyIndex> scratch;
+        CommandBucket::radix_sort(entries, scratch);
+        REQUIRE(entries == expected);
+    }
+
+    SECTION("pass dominates every other field") {
+        uint64_t early = CommandBucket::make_key(0, 63, 4095, ~0ULL, ~0ULL, 1.0f);
+        uint64_t late = CommandBucket::make_key(1, 0, 0, 0, 0, 0.0f);
+        REQUIRE(early < late);
+    }
+
+    SECTION("program dominates render state and depth") {
+        uint64_t a = CommandBucket::make_key(0, 0, 1, ~0ULL, 0, 1.0f);
+        uint64_t b = CommandBucket::make_key(0, 0, 2, 0, 0, 0.0f);
+        REQUIRE(a < b);
+    }
+
+    SECTION("depth orders otherwise equal draws front to back") {
+        uint64_t near = CommandBucket::make_key(0, 0, 1, 5, 5, 0.25f);
+        uint64_t far = CommandBucket::make_key(0, 0, 1, 5, 5, 0.75f);
+        REQUIRE(near < far);
+    }
+}
+
+#ifdef CHML_HAVE_EGL
+
+class EmptyDrawable : public Drawable {
+  public:
+    void on_draw() override {
+
+    }
+
+    VAO get_vao() override {
+        return VAO();
+    }
+};
+
+TEST_CASE("command bucket sorts draws between barriers", "[command_bucket]") {
+    GLTestContext gl;
+    AbstractSurfacePtr surface(new DummyFramebuffer(64, 64));
+    EmptyDrawable drawable;
+    // Programs are numbered in creation order, so `first` sorts first
+    Program first;
+    Program second;
+    REQUIRE(first.id < second.id);
+
+    auto draw = [&](Program & program) {
+        return CommandPtr(new DrawCommand(drawable, program, surface));
+    };
+    CommandPtr clear(new ClearCommand(surface, ClearCommand::CLEAR_COLOR));
+    CommandPtr dispatch(new ComputeCommand(first, glm::uvec3(1)));
+    CommandPtr readback(new ReadbackCommand(
+                            surface, gl.context.get_readback_queue()));
+
+    SECTION("draws are sorted within a segment") {
+        CommandPtr a = draw(second);
+        CommandPtr b = draw(first);
+        CommandPtr c = draw(second);
+        CommandBucket bucket(CommandList({a, b, c}));
+        REQUIRE(bucket.sorted() == CommandList({b, a, c}));
+    }
+
+    SECTION("draws never move across a barrier") {
+        CommandPtr a = draw(second);
+        CommandPtr b = draw(first);
+        CommandPtr c = draw(second);
+        CommandPtr d = draw(first);
+        CommandPtr e = draw(second);
+        CommandPtr f = draw(first);
+        CommandBucket bucket(CommandList({
+            a, b, clear, c, d, dispatch, e, readback, f
+        }));
+        REQUIRE(bucket.sorted() == CommandList({
+            b, a, clear, d, c, dispatch, e, readback, f
+        }));
+    }
+
+    SECTION("leading, trailing and adjacent barriers keep their place") {
+        CommandPtr a = draw(second);
+        CommandPtr b = draw(first);
+        CommandBucket bucket(CommandList({
+            clear, dispatch, a, b, readback, clear
+        }));
+        REQUIRE(bucket.sorted() == CommandList({
+            clear, dispatch, b, a, readback, clear
+        }));
+    }
+
+    SECTION("later passes run after earlier ones") {
+        CommandPtr a = draw(first);
+        CommandPtr b = draw(second);
+        std::static_pointer_cast<DrawCommand>(a)->set_sort_hints(1);
+        CommandBucket bucket(CommandList({a, b}));
+        REQUIRE(bucket.sorted() == CommandList({b, a}));
+    }
+}
+
+#endif
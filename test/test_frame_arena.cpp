@@ -0,0 +1,78 @@
+//
+// ChameleonGL - A small framework for OpenGL.
+// Copyright (C) 2012-2017 Srinivas Kaza
+//
+// This file is part of ChameleonGL.
+//
+// ChameleonGL is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ChameleonGL is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ChameleonGL.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include <cstdint>
+#include <memory>
+
+#include "catch.hpp"
+
+#include "frame_arena.hpp"
+
+TEST_CASE("frame arena reuses its blocks", "[frame_arena]") {
+    FrameArena arena(256);
+
+    SECTION("allocations are aligned") {
+        arena.allocate(1, 1);
+        void* ptr = arena.allocate(16, 16);
+        REQUIRE(((uintptr_t) ptr) % 16 == 0);
+        arena.deallocate(ptr);
+    }
+
+    SECTION("oversized allocations get their own block") {
+        void* ptr = arena.allocate(1024, 8);
+        REQUIRE(ptr != nullptr);
+        REQUIRE(arena.capacity() >= 1024);
+        arena.deallocate(ptr);
+    }
+
+    SECTION("a reset arena does not grow for a frame of the same shape") {
+        for (int frame = 0; frame < 3; frame++) {
+            std::shared_ptr<uint64_t> a = arena.make_shared<uint64_t>(1);
+            std::shared_ptr<uint64_t> b = arena.make_shared<uint64_t>(2);
+            REQUIRE(*a + *b == 3);
+            a.reset();
+            b.reset();
+
+            REQUIRE(arena.live_allocations() == 0);
+            size_t capacity = arena.capacity();
+            arena.reset();
+            REQUIRE(arena.bytes_used() == 0);
+            REQUIRE(arena.capacity() == capacity);
+        }
+    }
+
+    SECTION("objects held across a reset are not overwritten") {
+        std::shared_ptr<uint64_t> held = arena.make_shared<uint64_t>(42);
+        arena.reset();
+        REQUIRE(arena.pinned_blocks() == 1);
+
+        for (int i = 0; i < 64; i++) {
+            std::shared_ptr<uint64_t> other =
+                arena.make_shared<uint64_t>(0xFFFFFFFF);
+        }
+        REQUIRE(*held == 42);
+
+        held.reset();
+        arena.reset();
+        REQUIRE(arena.pinned_blocks() == 0);
+        REQUIRE(arena.live_allocations() == 0);
+    }
+}
@@ -0,0 +1,187 @@
+//
+// ChameleonGL - A small framework for OpenGL.
+// Copyright (C) 2012-2017 Srinivas Kaza
+//
+// This file is part of ChameleonGL.
+//
+// ChameleonGL is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ChameleonGL is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ChameleonGL.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include <unordered_map>
+#include <future>
+#include <chrono>
+
+#include "catch.hpp"
+
+#include "input.hpp"
+#include "graphics_context.hpp"
+#include "clear_command.hpp"
+#include "readback_command.hpp"
+#include "draw_command.hpp"
+#include "mesh.hpp"
+#include "uniform_map.hpp"
+#include "gl_test_context.hpp"
+
+TEST_CASE("OpenGL versions are parsed", "[graphics_context]") {
+    int major = 0;
+    int minor = 0;
+    REQUIRE(GLContext::parse_version("4.3", major, minor));
+    REQUIRE(major == 4);
+    REQUIRE(minor == 3);
+    REQUIRE(GLContext::parse_version("10.12", major, minor));
+    REQUIRE(major == 10);
+    REQUIRE(minor == 12);
+
+    for (const char* malformed : {
+                "", "4", "43", "4.", ".3", "4.3.1", "4,3", "a.b", "4.3 ",
+                "-4.3", "400.3"
+            }) {
+        REQUIRE_FALSE(GLContext::parse_version(malformed, major, minor));
+    }
+}
+
+#ifdef CHML_HAVE_EGL
+
+// Clears the default surface and reads it back on the first frame
+class ClearReadbackRenderer : public Renderer {
+  public:
+    explicit ClearReadbackRenderer(ReadbackQueue& queue) :
+        queue(queue),
+        frame(0) {
+
+    }
+
+    void record(AbstractSurfacePtr surface,
+                FrameCommandList& commands) override {
+        if (frame++ > 0) {
+            return;
+        }
+        commands.emplace<ClearCommand>(surface,
+                                       ClearCommand::CLEAR_COLOR |
+                                       ClearCommand::CLEAR_DEPTH,
+                                       glm::vec4(1.0, 0.0, 0.0, 1.0));
+        result = commands.emplace<ReadbackCommand>(surface, queue)
+                 ->get_future();
+    }
+
+    ReadbackQueue& queue;
+    int frame;
+    std::future<Readback> result;
+};
+
+TEST_CASE("headless context renders and reads back", "[headless]") {
+    InputController input;
+    std::pair<int, int> viewport(64, 32);
+    bool headless = true;
+    int frames = 3;
+    std::unordered_map<std::string, void*> options;
+    options["width"] = &(viewport.first);
+    options["height"] = &(viewport.second);
+    options["headless"] = &headless;
+    options["frames"] = &frames;
+    GraphicsContext context(input, options);
+    REQUIRE(context.is_headless());
+
+    ClearReadbackRenderer renderer(context.get_readback_queue());
+    context.start(renderer);
+    REQUIRE(renderer.frame == frames);
+
+    // start() resolves every readback before returning
+    REQUIRE(renderer.result.wait_for(std::chrono::seconds(0)) ==
+            std::future_status::ready);
+    Readback readback = renderer.result.get();
+    REQUIRE(readback.width == 64);
+    REQUIRE(readback.height == 32);
+    REQUIRE(readback.size == 64 * 32 * 4);
+    size_t red_pixels = 0;
+    for (size_t i = 0; i < readback.size; i += 4) {
+        if (readback.data[i + 0] == 255 && readback.data[i + 1] == 0 &&
+                readback.data[i + 2] == 0 && readback.data[i + 3] == 255) {
+            red_pixels++;
+        }
+    }
+    REQUIRE(red_pixels == 64 * 32);
+}
+
+
+// Draws a textured quad every frame and keeps the heap allocation count of
+// each finished frame. The stats of a frame are complete once the next
+// frame is recorded.
+class TexturedQuadRenderer : public Renderer {
+  public:
+    TexturedQuadRenderer(const GraphicsContext& context,
+                         const int& frames) :
+        context(context),
+        texture(GL_TEXTURE_2D, 4, 4),
+        quad(Mesh::construct_fullscreen_quad()),
+        allocations(frames, 0),
+        frame(0) {
+        glTextureStorage2D(texture.id, 1, GL_RGBA8, 4, 4);
+        program.compile_shader("#version 430\n"
+                               "layout(location = 0) in vec3 position;\n"
+                               "void main() {\n"
+                               "    gl_Position = vec4(position, 1.0);\n"
+                               "}\n", GL_VERTEX_SHADER, false, true);
+        program.compile_shader("#version 430\n"
+                               "uniform sampler2D tex;\n"
+                               "out vec4 color;\n"
+                               "void main() {\n"
+                               "    color = texture(tex, vec2(0.5));\n"
+                               "}\n", GL_FRAGMENT_SHADER, false, true);
+        program.link_program();
+        map.set("tex"_u, texture);
+    }
+
+    void record(AbstractSurfacePtr surface,
+                FrameCommandList& commands) override {
+        if (frame > 0) {
+            allocations[frame - 1] =
+                context.get_frame_stats().heap_allocations;
+        }
+        frame++;
+
+        commands.emplace<ClearCommand>(surface,
+                                       ClearCommand::CLEAR_COLOR,
+                                       glm::vec4(0.0));
+        commands.emplace<DrawCommand>(quad, program, surface, map,
+                                      render_state);
+    }
+
+    const GraphicsContext& context;
+    Program program;
+    Texture texture;
+    Mesh quad;
+    UniformMap map;
+    RenderState render_state;
+    // Written by index, so that recording them allocates nothing
+    std::vector<size_t> allocations;
+    int frame;
+};
+
+TEST_CASE("steady state frames do not allocate", "[headless]") {
+    GLTestContext gl(64, 64, 5);
+    TexturedQuadRenderer renderer(gl.context, gl.frames);
+    gl.context.start(renderer);
+    REQUIRE(renderer.frame == gl.frames);
+
+    // The first frame resolves uniform locations and may allocate; every
+    // later frame must not (counted through ALLOCATION_COUNTING_INIT)
+    for (int i = 1; i < gl.frames - 1; i++) {
+        INFO("frame " << i);
+        REQUIRE(renderer.allocations[i] == 0);
+    }
+}
+
+#endif
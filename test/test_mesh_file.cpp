@@ -0,0 +1,132 @@
+//
+// ChameleonGL - A small framework for OpenGL.
+// Copyright (C) 2012-2017 Srinivas Kaza
+//
+// This file is part of ChameleonGL.
+//
+// ChameleonGL is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ChameleonGL is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ChameleonGL.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include <vector>
+#include <string>
+#include <thread>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+
+#include "catch.hpp"
+
+#include "mesh_file.hpp"
+
+TEST_CASE("mesh files round trip", "[mesh_file]") {
+    MeshData mesh;
+    mesh.vertex_size = 8;
+    mesh.formats = std::vector<VertexFormat>({
+        {0, 2, GL_FLOAT, GL_FALSE, 0},
+    });
+    mesh.num_vertices = 3;
+    std::vector<float> vertices = {0, 0, 1, 0, 0, 1};
+    mesh.vertices = std::vector<uint8_t>(
+                        (const uint8_t*) vertices.data(),
+                        (const uint8_t*)(vertices.data() + vertices.size()));
+    mesh.index_type = GL_UNSIGNED_SHORT;
+    mesh.num_indices = 3;
+    std::vector<uint16_t> indices = {0, 1, 2};
+    mesh.indices = std::vector<uint8_t>(
+                       (const uint8_t*) indices.data(),
+                       (const uint8_t*)(indices.data() + indices.size()));
+    mesh.bounds_min = glm::vec3(0.0f);
+    mesh.bounds_max = glm::vec3(1.0f, 1.0f, 0.0f);
+    mesh.meshlets = std::vector<Meshlet>({
+        {0, 3, glm::vec4(0.5f, 0.5f, 0.0f, 1.0f)}
+    });
+
+    std::string filename = "mesh_file_test.mesh";
+    REQUIRE(MeshFile::write(filename, mesh, 1234, 5678));
+
+    SECTION("contents are read back") {
+        MeshFile file;
+        REQUIRE(file.open(filename));
+        REQUIRE(file.matches_source(1234, 5678));
+        REQUIRE(file.vertex_size() == 8);
+        REQUIRE(file.num_vertices() == 3);
+        REQUIRE(file.index_type() == GL_UNSIGNED_SHORT);
+        REQUIRE(file.num_indices() == 3);
+        REQUIRE(file.bounds_max() == mesh.bounds_max);
+
+        std::vector<VertexFormat> formats = file.formats();
+        REQUIRE(formats.size() == 1);
+        REQUIRE(formats[0].size == 2);
+        REQUIRE(formats[0].type == GL_FLOAT);
+
+        std::vector<Meshlet> meshlets = file.meshlets();
+        REQUIRE(meshlets.size() == 1);
+        REQUIRE(meshlets[0].index_count == 3);
+        REQUIRE(meshlets[0].bounds == mesh.meshlets[0].bounds);
+
+        REQUIRE(std::memcmp(file.index_data(), indices.data(),
+                            indices.size() * sizeof(uint16_t)) == 0);
+        REQUIRE(std::memcmp(file.vertex_data(), vertices.data(),
+                            vertices.size() * sizeof(float)) == 0);
+    }
+
+    SECTION("a changed source does not match") {
+        MeshFile file;
+        REQUIRE(file.open(filename));
+        REQUIRE_FALSE(file.matches_source(1234, 5679));
+        REQUIRE_FALSE(file.matches_source(1235, 5678));
+    }
+
+    SECTION("corrupted files are not opened") {
+        {
+            FILE* f = std::fopen(filename.c_str(), "r+b");
+            REQUIRE(f != nullptr);
+            std::fseek(f, -1, SEEK_END);
+            std::fputc(0x7f, f);
+            std::fclose(f);
+        }
+
+        MeshFile file;
+        REQUIRE_FALSE(file.open(filename));
+        REQUIRE(file.open(filename, false));
+    }
+
+    SECTION("concurrent writers do not corrupt the file") {
+        std::vector<std::thread> writers;
+        for (int i = 0; i < 4; i++) {
+            writers.emplace_back([&]() {
+                for (int j = 0; j < 20; j++) {
+                    MeshFile::write(filename, mesh, 1234, 5678);
+                }
+            });
+        }
+        for (std::thread& writer : writers) {
+            writer.join();
+        }
+
+        MeshFile file;
+        REQUIRE(file.open(filename));
+        REQUIRE(std::memcmp(file.vertex_data(), vertices.data(),
+                            vertices.size() * sizeof(float)) == 0);
+    }
+
+    SECTION("missing files are not opened") {
+        MeshFile file;
+        REQUIRE_FALSE(file.open("no_such_mesh.mesh"));
+        REQUIRE_FALSE(file.is_open());
+    }
+
+    std::remove(filename.c_str());
+}
@@ -0,0 +1,75 @@
+//
+// ChameleonGL - A small framework for OpenGL.
+// Copyright (C) 2012-2017 Srinivas Kaza
+//
+// This file is part of ChameleonGL.
+//
+// ChameleonGL is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ChameleonGL is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ChameleonGL.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include <vector>
+#include <string>
+#include <cstring>
+
+#include "catch.hpp"
+
+#include "obj_parser.hpp"
+
+static void require_same(const ObjData& a, const ObjData& b) {
+    REQUIRE(a.attrib.vertices == b.attrib.vertices);
+    REQUIRE(a.attrib.normals == b.attrib.normals);
+    REQUIRE(a.attrib.texcoords == b.attrib.texcoords);
+    REQUIRE(a.indices.size() == b.indices.size());
+    for (size_t i = 0; i < a.indices.size(); i++) {
+        REQUIRE(a.indices[i].vertex_index == b.indices[i].vertex_index);
+        REQUIRE(a.indices[i].normal_index == b.indices[i].normal_index);
+        REQUIRE(a.indices[i].texcoord_index == b.indices[i].texcoord_index);
+    }
+}
+
+TEST_CASE("parallel OBJ parsing matches tinyobj", "[obj_parser]") {
+    for (const std::string filename : {
+                "assets/cornell_box.obj", "assets/sculpt.obj"
+            }) {
+        ObjData reference = ObjParser::parse_reference(filename);
+        for (size_t num_threads : {1, 3, 8}) {
+            require_same(ObjParser::parse(filename, num_threads), reference);
+        }
+    }
+}
+
+TEST_CASE("relative indices are offset across chunks", "[obj_parser]") {
+    const std::string text =
+        "v 0 0 0\n"
+        "v 1 0 0\n"
+        "v 0 1 0\n"
+        "vt 0 0\n"
+        "vt 1 1\n"
+        "f -3/-2 -2/-1 -1/-2\n"
+        "v 1 1 0\n"
+        "f 1 -1 -2 2\n";
+
+    ObjData data = ObjParser::parse(text.data(), text.size(), 8);
+    REQUIRE(data.attrib.vertices.size() == 12);
+    REQUIRE(data.indices.size() == 9);
+
+    std::vector<int> vertices;
+    for (const tinyobj::index_t& idx : data.indices) {
+        vertices.push_back(idx.vertex_index);
+    }
+    REQUIRE(vertices == std::vector<int>({0, 1, 2, 0, 3, 2, 0, 2, 1}));
+    REQUIRE(data.indices[1].texcoord_index == 1);
+    REQUIRE(data.indices[3].texcoord_index == -1);
+}
@@ -0,0 +1,67 @@
+//
+// ChameleonGL - A small framework for OpenGL.
+// Copyright (C) 2012-2017 Srinivas Kaza
+//
+// This file is part of ChameleonGL.
+//
+// ChameleonGL is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ChameleonGL is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ChameleonGL.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include <vector>
+#include <memory>
+
+#include "catch.hpp"
+
+#include "command.hpp"
+#include "frame_command_list.hpp"
+#include "parallel_recorder.hpp"
+
+class IndexCommand : public Command {
+  public:
+    explicit IndexCommand(const size_t& index) :
+        index(index) {
+    }
+
+    void operator()() override {
+    }
+
+    size_t index;
+};
+
+TEST_CASE("parallel recording merges buffers in job order",
+          "[parallel_recorder]") {
+    ParallelRecorder recorder(4);
+    const size_t num_jobs = 64;
+    const size_t per_job = 100;
+
+    auto job = [per_job](size_t i, FrameCommandList & commands) {
+        for (size_t j = 0; j < per_job; j++) {
+            commands.emplace<IndexCommand>(i * per_job + j);
+        }
+    };
+
+    // Record twice so that the second frame reuses the first frame's buffers
+    for (int frame = 0; frame < 2; frame++) {
+        FrameCommandList merged;
+        recorder.record(num_jobs, job, merged);
+
+        REQUIRE(merged.size() == num_jobs * per_job);
+        for (size_t i = 0; i < merged.size(); i++) {
+            auto command =
+                std::static_pointer_cast<IndexCommand>(merged.commands()[i]);
+            REQUIRE(command->index == i);
+        }
+    }
+}
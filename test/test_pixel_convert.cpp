@@ -0,0 +1,132 @@
+//
+// ChameleonGL - A small framework for OpenGL.
+// Copyright (C) 2012-2017 Srinivas Kaza
+//
+// This file is part of ChameleonGL.
+//
+// ChameleonGL is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ChameleonGL is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ChameleonGL.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include <vector>
+#include <random>
+#include <cstdint>
+#include <cstring>
+
+#include "catch.hpp"
+
+#include "image_data.hpp"
+#include "pixel_convert.hpp"
+
+// ImagePool::add's conversion as it was before PixelConverter, minus the
+// per-pixel allocation
+static std::vector<uint8_t> legacy_convert(SDL_Surface* surface) {
+    SDL_PixelFormat* fmt = surface->format;
+    std::vector<uint8_t> data(surface->w * surface->h * fmt->BytesPerPixel);
+
+    uint32_t pixel, temp;
+    for (int j = 0; j < surface->h; j++) {
+        for (int i = 0; i < surface->w; i++) {
+            size_t byte_offset = (i + j * surface->w) * fmt->BytesPerPixel;
+            size_t src_offset = i * fmt->BytesPerPixel + j * surface->pitch;
+
+            pixel = 0;
+            std::memcpy(&pixel, (uint8_t*) surface->pixels + src_offset,
+                        fmt->BytesPerPixel);
+
+            temp = ((pixel & fmt->Rmask) >> fmt->Rshift) << fmt->Rloss;
+            data[byte_offset] = (uint8_t) temp;
+            if (fmt->BytesPerPixel > 1) {
+                temp = ((pixel & fmt->Gmask) >> fmt->Gshift) << fmt->Gloss;
+                data[byte_offset + 1] = (uint8_t) temp;
+            }
+            if (fmt->BytesPerPixel > 2) {
+                temp = ((pixel & fmt->Bmask) >> fmt->Bshift) << fmt->Bloss;
+                data[byte_offset + 2] = (uint8_t) temp;
+            }
+            if (fmt->BytesPerPixel > 3) {
+                temp = ((pixel & fmt->Amask) >> fmt->Ashift) << fmt->Aloss;
+                data[byte_offset + 3] = (uint8_t) temp;
+            }
+        }
+    }
+    return data;
+}
+
+static std::vector<uint8_t> convert(SDL_Surface* surface) {
+    std::vector<uint8_t> data(surface->w * surface->h *
+                              surface->format->BytesPerPixel);
+    PixelConverter::convert(ImagePool::channel_layout(surface->format),
+                            (const uint8_t*) surface->pixels,
+                            surface->pitch, surface->w, surface->h,
+                            data.data());
+    return data;
+}
+
+TEST_CASE("pixel conversion matches the per-pixel path", "[pixel_convert]") {
+    SDL_Surface* image = IMG_Load("assets/tex_0.jpg");
+    REQUIRE(image != NULL);
+
+    SECTION("on the decoded image") {
+        REQUIRE(convert(image) == legacy_convert(image));
+    }
+
+    SECTION("after converting to other layouts") {
+        for (Uint32 format : {
+                    SDL_PIXELFORMAT_RGB24, SDL_PIXELFORMAT_BGR24,
+                    SDL_PIXELFORMAT_RGBA32, SDL_PIXELFORMAT_ARGB8888,
+                    SDL_PIXELFORMAT_BGRA8888, SDL_PIXELFORMAT_RGB888,
+                    SDL_PIXELFORMAT_RGB565
+                }) {
+            SDL_Surface* converted = SDL_ConvertSurfaceFormat(image, format, 0);
+            REQUIRE(converted != NULL);
+            REQUIRE(convert(converted) == legacy_convert(converted));
+            SDL_FreeSurface(converted);
+        }
+    }
+
+    SDL_FreeSurface(image);
+}
+
+TEST_CASE("pixel conversion handles odd widths and row padding",
+          "[pixel_convert]") {
+    ChannelLayout bgra({
+        4,
+        {0x00ff0000, 0x0000ff00, 0x000000ff, 0xff000000},
+        {16, 8, 0, 24},
+        {0, 0, 0, 0}
+    });
+
+    std::mt19937 rng(1);
+    for (int width : {1, 3, 4, 7, 8, 9, 33}) {
+        const int height = 3;
+        const size_t pitch = width * 4 + 12;
+        std::vector<uint8_t> src(pitch * height);
+        for (uint8_t& byte : src) {
+            byte = (uint8_t) rng();
+        }
+
+        std::vector<uint8_t> fast(width * height * 4);
+        PixelConverter::convert(bgra, src.data(), pitch, width, height,
+                                fast.data());
+
+        std::vector<uint8_t> generic(fast.size());
+        for (int j = 0; j < height; j++) {
+            PixelConverter::convert_generic(bgra, src.data() + j * pitch,
+                                            generic.data() + j * width * 4,
+                                            width);
+        }
+        REQUIRE(fast == generic);
+    }
+}
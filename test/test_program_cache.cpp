@@ -0,0 +1,141 @@
+//
+// ChameleonGL - A small framework for OpenGL.
+// Copyright (C) 2012-2017 Srinivas Kaza
+//
+// This file is part of ChameleonGL.
+//
+// ChameleonGL is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ChameleonGL is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ChameleonGL.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <cstdint>
+#include <fstream>
+#include <thread>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "catch.hpp"
+
+#include "program_cache.hpp"
+
+TEST_CASE("program cache keys and binaries", "[program_cache]") {
+    ShaderSource vertex({GL_VERTEX_SHADER, "void main() {}", ""});
+    ShaderSource fragment({GL_FRAGMENT_SHADER, "void main() {}", ""});
+    std::vector<ShaderSource> sources = {vertex, fragment};
+    uint64_t key = ProgramCache::key(sources, "driver");
+
+    SECTION("keys are stable") {
+        REQUIRE(ProgramCache::key(sources, "driver") == key);
+    }
+
+    SECTION("keys depend on the driver, stages and sources") {
+        REQUIRE(ProgramCache::key(sources, "other driver") != key);
+
+        std::vector<ShaderSource> swapped = {fragment, vertex};
+        REQUIRE(ProgramCache::key(swapped, "driver") != key);
+
+        std::vector<ShaderSource> edited = sources;
+        edited[1].source = "#define FOO\nvoid main() {}";
+        REQUIRE(ProgramCache::key(edited, "driver") != key);
+    }
+
+    SECTION("binaries round trip through a file") {
+        std::string filename = "program_cache_test.bin";
+        std::vector<uint8_t> binary = {1, 2, 3, 4, 5};
+        REQUIRE(ProgramCache::write_binary(filename, 0x1234, binary));
+
+        GLenum format = 0;
+        std::vector<uint8_t> loaded;
+        REQUIRE(ProgramCache::read_binary(filename, format, loaded));
+        REQUIRE(format == 0x1234);
+        REQUIRE(loaded == binary);
+        std::remove(filename.c_str());
+    }
+
+    SECTION("binaries whose length does not match the file are not read") {
+        std::string filename = "program_cache_test.bin";
+        std::vector<uint8_t> binary = {1, 2, 3, 4, 5};
+        REQUIRE(ProgramCache::write_binary(filename, 0x1234, binary));
+
+        // Claim a 4 GB binary
+        {
+            std::fstream file(filename, std::ios::binary |
+                              std::ios::in | std::ios::out);
+            uint32_t length = 0xFFFFFFFF;
+            file.seekp(2 * sizeof(uint32_t));
+            file.write((const char*) &length, sizeof(length));
+        }
+
+        GLenum format = 0;
+        std::vector<uint8_t> loaded;
+        REQUIRE_FALSE(ProgramCache::read_binary(filename, format, loaded));
+        REQUIRE(loaded.empty());
+        std::remove(filename.c_str());
+    }
+
+    SECTION("concurrent writers do not corrupt a binary") {
+        std::string filename = "program_cache_test.bin";
+        std::vector<uint8_t> binary(4096, 7);
+        std::vector<std::thread> writers;
+        for (int i = 0; i < 4; i++) {
+            writers.emplace_back([&]() {
+                for (int j = 0; j < 20; j++) {
+                    ProgramCache::write_binary(filename, 0x1234, binary);
+                }
+            });
+        }
+        for (std::thread& writer : writers) {
+            writer.join();
+        }
+
+        GLenum format = 0;
+        std::vector<uint8_t> loaded;
+        REQUIRE(ProgramCache::read_binary(filename, format, loaded));
+        REQUIRE(loaded == binary);
+        std::remove(filename.c_str());
+    }
+
+    SECTION("failed writes leave no temporary behind") {
+        // A binary cannot be renamed over a directory
+        std::string directory = "program_cache_test_dir";
+        REQUIRE(mkdir(directory.c_str(), 0755) == 0);
+        std::vector<uint8_t> binary = {1, 2, 3};
+        REQUIRE_FALSE(ProgramCache::write_binary(directory, 0x1234,
+                                                 binary));
+        rmdir(directory.c_str());
+
+        DIR* dir = opendir(".");
+        REQUIRE(dir != nullptr);
+        size_t leftovers = 0;
+        while (struct dirent* entry = readdir(dir)) {
+            if (std::string(entry->d_name).find(directory + ".") == 0) {
+                leftovers++;
+            }
+        }
+        closedir(dir);
+        REQUIRE(leftovers == 0);
+    }
+
+    SECTION("missing binaries are not read") {
+        GLenum format = 0;
+        std::vector<uint8_t> loaded;
+        REQUIRE_FALSE(ProgramCache::read_binary("no_such_binary.bin",
+                                                format, loaded));
+    }
+}
@@ -0,0 +1,117 @@
+//
+// ChameleonGL - A small framework for OpenGL.
+// Copyright (C) 2012-2017 Srinivas Kaza
+//
+// This file is part of ChameleonGL.
+//
+// ChameleonGL is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ChameleonGL is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ChameleonGL.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+
+#include <vector>
+#include <string>
+
+#include "catch.hpp"
+
+#include "program_reflection.hpp"
+
+static ProgramResource uniform(const std::string& name,
+                               const GLenum& type,
+                               const GLint& location) {
+    ProgramResource resource;
+    resource.id = intern_name(name);
+    resource.name = name;
+    resource.type = type;
+    resource.location = location;
+    resource.array_size = 1;
+    resource.index = (GLuint) location;
+    return resource;
+}
+
+TEST_CASE("program reflection tables", "[program_reflection]") {
+    ProgramReflection reflection;
+    reflection.uniforms = {
+        uniform("chml_model", GL_FLOAT_MAT4, 0),
+        uniform("tex", GL_SAMPLER_2D, 1),
+        uniform("color", GL_FLOAT_VEC4, 2)
+    };
+    reflection.sort();
+
+    SECTION("names are found by id") {
+        const ProgramResource* tex =
+            ProgramReflection::find(reflection.uniforms, intern_name("tex"));
+        REQUIRE(tex != nullptr);
+        REQUIRE(tex->name == "tex");
+        REQUIRE(tex->type == GL_SAMPLER_2D);
+        REQUIRE(ProgramReflection::find(reflection.uniforms,
+                                        intern_name("missing")) == nullptr);
+    }
+
+    SECTION("handles resolve to locations") {
+        UniformHandle color = reflection.uniform_handle(intern_name("color"));
+        REQUIRE(color.index >= 0);
+        REQUIRE(reflection.location(color) == 2);
+
+        UniformHandle missing =
+            reflection.uniform_handle(intern_name("missing"));
+        REQUIRE(missing.index == -1);
+        REQUIRE(reflection.location(missing) == -1);
+    }
+
+    SECTION("handles survive the table changing") {
+        UniformHandle color = reflection.uniform_handle(intern_name("color"));
+
+        reflection.uniforms.insert(reflection.uniforms.begin(),
+                                   uniform("added", GL_FLOAT, 7));
+        reflection.uniforms.push_back(uniform("other", GL_FLOAT, 8));
+        for (ProgramResource& resource : reflection.uniforms) {
+            resource.location += 10;
+        }
+        reflection.sort();
+
+        REQUIRE(reflection.location(color) == 12);
+    }
+}
+
+TEST_CASE("uniform names are interned at compile time",
+          "[program_reflection]") {
+    constexpr UniformName view = "chml_view"_u;
+    static_assert(view.id == intern_name("chml_view", 9),
+                  "literal names are hashed at compile time");
+    static_assert(UniformName("chml_view").id == view.id,
+                  "plain pointers are hashed up to their terminator");
+
+    std::string runtime_name = "chml_view";
+    UniformName from_string(runtime_name);
+    REQUIRE(from_string.id == view.id);
+    REQUIRE(view.is_literal);
+    REQUIRE_FALSE(from_string.is_literal);
+    REQUIRE(UniformName("chml_projection").id != view.id);
+}
+
+TEST_CASE("uniform names from buffers are not literals",
+          "[program_reflection]") {
+    // Only the bytes before the terminator belong to the name
+    char buffer[32] = "chml_view";
+    buffer[20] = 'x';
+    UniformName from_buffer(buffer);
+    REQUIRE(from_buffer.id == intern_name("chml_view", 9));
+    REQUIRE_FALSE(from_buffer.is_literal);
+
+    const char* pointer = buffer;
+    UniformName from_pointer(pointer);
+    REQUIRE(from_pointer.id == from_buffer.id);
+    REQUIRE_FALSE(from_pointer.is_literal);
+}
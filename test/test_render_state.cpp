@@ -0,0 +1,58 @@
+//
+// ChameleonGL - A small framework for OpenGL.
+// Copyright (C) 2012-2017 Srinivas Kaza
+//
+// This file is part of ChameleonGL.
+//
+// ChameleonGL is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ChameleonGL is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ChameleonGL.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include "catch.hpp"
+
+#include "render_state.hpp"
+
+TEST_CASE("render states compare by value", "[render_state]") {
+    RenderState a({GL_MULTISAMPLE, GL_DITHER, GL_DEPTH_TEST});
+    RenderState b({GL_DEPTH_TEST, GL_DITHER, GL_MULTISAMPLE});
+
+    SECTION("enable order does not matter") {
+        REQUIRE(a == b);
+        REQUIRE(a.is_enabled(GL_DEPTH_TEST));
+        REQUIRE_FALSE(a.is_enabled(GL_BLEND));
+    }
+
+    SECTION("explicit defaults are equal to unset parameters") {
+        b.set_param(DepthFunction());
+        b.set_param(BlendFunction());
+        REQUIRE(a == b);
+    }
+
+    SECTION("changed parameters are detected") {
+        b.set_param(DepthFunction({GL_LEQUAL}));
+        REQUIRE(a != b);
+        a.set_param(DepthFunction({GL_LEQUAL}));
+        REQUIRE(a == b);
+    }
+
+    SECTION("changed capabilities are detected") {
+        b.disable(GL_DEPTH_TEST);
+        REQUIRE(a != b);
+        b.enable(GL_DEPTH_TEST);
+        REQUIRE(a == b);
+    }
+
+    SECTION("unknown capabilities are rejected") {
+        REQUIRE_THROWS(a.enable(GL_TEXTURE_2D));
+    }
+}
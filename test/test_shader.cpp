@@ -30,6 +30,8 @@
 #include "util.hpp"
 
 STATIC_INIT()
+// Lets tests check FrameStats::heap_allocations
+ALLOCATION_COUNTING_INIT()
 
 TEST_CASE("shader function creation works", "[shader]") {
     InputController input;
@@ -39,6 +41,10 @@ TEST_CASE("shader function creation works", "[shader]") {
     options["width"] = &(viewport.first);
     options["height"] = &(viewport.second);
     options["opengl_version"] = &version;
+#ifdef CHML_HAVE_EGL
+    bool headless = true;
+    options["headless"] = &headless;
+#endif
     GraphicsContext context(input, options);
 
     std::string simple_example =
@@ -0,0 +1,107 @@
+//
+// ChameleonGL - A small framework for OpenGL.
+// Copyright (C) 2012-2017 Srinivas Kaza
+//
+// This file is part of ChameleonGL.
+//
+// ChameleonGL is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ChameleonGL is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ChameleonGL.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include <string>
+#include <fstream>
+#include <thread>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+
+#include "catch.hpp"
+
+#include "shader_watcher.hpp"
+#include "gl_test_context.hpp"
+
+#ifdef CHML_HAVE_EGL
+
+static void write_shader(const std::string& filename,
+                         const std::string& expression) {
+    std::ofstream file(filename);
+    file << "#version 430\n"
+         "layout(local_size_x = 1) in;\n"
+         "uniform float scale;\n"
+         "layout(std430) buffer Unused { float unused[]; };\n"
+         "layout(std430) buffer Values { float values[]; };\n"
+         "void main() {\n"
+         "    values[0] = " << expression << " + unused[0];\n"
+         "}\n";
+}
+
+static GLint ssbo_binding(const Program& program, const char* name) {
+    GLuint index = glGetProgramResourceIndex(program.id,
+                                             GL_SHADER_STORAGE_BLOCK, name);
+    const GLenum property = GL_BUFFER_BINDING;
+    GLint binding = -1;
+    glGetProgramResourceiv(program.id, GL_SHADER_STORAGE_BLOCK, index,
+                           1, &property, 1, nullptr, &binding);
+    return binding;
+}
+
+TEST_CASE("shader watcher reloads edited shaders", "[shader_watcher]") {
+    GLTestContext gl;
+    char directory[] = "/tmp/chml_shader_watcher_XXXXXX";
+    REQUIRE(mkdtemp(directory) != nullptr);
+    std::string filename = std::string(directory) + "/values.comp";
+    write_shader(filename, "scale");
+
+    Program program;
+    program.add_shader(filename, GL_COMPUTE_SHADER);
+    REQUIRE(program.link_program());
+
+    // Values is attached second, so it does not keep the default binding
+    Buffer unused;
+    Buffer values;
+    program.attach_ssbo(unused, "Unused");
+    program.attach_ssbo(values, "Values");
+    program.set_uniform("scale"_u, 3.0f);
+    REQUIRE(ssbo_binding(program, "Values") == 1);
+
+    ShaderWatcher watcher;
+    watcher.watch(program);
+    GLuint old_id = program.id;
+    write_shader(filename, "2.0 * scale");
+
+    size_t swapped = 0;
+    for (int i = 0; i < 500 && swapped == 0; i++) {
+        swapped = watcher.update();
+        if (swapped == 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    }
+    REQUIRE(swapped == 1);
+    REQUIRE(program.id != old_id);
+    REQUIRE(program.get_shader_sources()[0].source.find("2.0 * scale") !=
+            std::string::npos);
+
+    GLfloat scale = 0.0f;
+    glGetUniformfv(program.id, glGetUniformLocation(program.id, "scale"),
+                   &scale);
+    REQUIRE(scale == 3.0f);
+    REQUIRE(ssbo_binding(program, "Values") == 1);
+
+    watcher.unwatch(program);
+    std::remove(filename.c_str());
+    rmdir(directory);
+}
+
+#endif
@@ -0,0 +1,92 @@
+//
+// ChameleonGL - A small framework for OpenGL.
+// Copyright (C) 2012-2017 Srinivas Kaza
+//
+// This file is part of ChameleonGL.
+//
+// ChameleonGL is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ChameleonGL is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ChameleonGL.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <string>
+#include <thread>
+#include <chrono>
+
+#include "catch.hpp"
+
+#include "texture_loader.hpp"
+#include "gl_test_context.hpp"
+
+#ifdef CHML_HAVE_EGL
+
+// Runs update() until `texture` has its image, or gives up after a while
+static bool wait_for(TextureLoader& loader, const Texture& texture) {
+    for (int i = 0; i < 1000 && !loader.is_loaded(texture); i++) {
+        loader.update();
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return loader.is_loaded(texture);
+}
+
+static GLint max_level(const Texture& texture) {
+    GLint level = -1;
+    glGetTextureParameteriv(texture.id, GL_TEXTURE_MAX_LEVEL, &level);
+    return level;
+}
+
+TEST_CASE("textures load in the background", "[texture_loader]") {
+    GLTestContext gl;
+    TextureLoader loader(1);
+
+    Texture texture = loader.load("assets/tex_1.jpg", GL_RGBA8);
+    REQUIRE(texture.width == 1);
+    REQUIRE(texture.height == 1);
+    REQUIRE(max_level(texture) == 0);
+    REQUIRE_FALSE(loader.refresh(texture));
+
+    REQUIRE(wait_for(loader, texture));
+    REQUIRE(loader.pending() == 0);
+
+    // The copy load() returned learns the real size once asked
+    REQUIRE(loader.refresh(texture));
+    REQUIRE(texture.width > 1);
+    REQUIRE(texture.height > 1);
+
+    // The placeholder's level cap must not outlive it
+    REQUIRE(max_level(texture) > 0);
+}
+
+TEST_CASE("missing textures keep the placeholder", "[texture_loader]") {
+    GLTestContext gl;
+    TextureLoader loader(1);
+
+    Texture texture = loader.load("assets/no_such_texture.png", GL_RGBA8);
+    REQUIRE(wait_for(loader, texture));
+    REQUIRE(loader.refresh(texture));
+    REQUIRE(texture.width == 1);
+    REQUIRE(texture.height == 1);
+}
+
+TEST_CASE("the texture loader can be shut down early", "[texture_loader]") {
+    GLTestContext gl;
+    TextureLoader loader(2);
+    loader.load("assets/tex_1.jpg", GL_RGBA8);
+
+    loader.shutdown();
+    // Nothing decodes after a shutdown, and doing it twice is harmless
+    loader.shutdown();
+    loader.clear();
+    REQUIRE(loader.pending() == 0);
+}
+
+#endif
@@ -0,0 +1,126 @@
+//
+// ChameleonGL - A small framework for OpenGL.
+// Copyright (C) 2012-2017 Srinivas Kaza
+//
+// This file is part of ChameleonGL.
+//
+// ChameleonGL is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ChameleonGL is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ChameleonGL.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+#include <vector>
+#include <cstdint>
+
+#include "catch.hpp"
+
+#include "texture_streamer.hpp"
+#include "gl_test_context.hpp"
+
+#ifdef CHML_HAVE_EGL
+
+// Bytes of one RGBA8 update of `width` x `height` pixels
+static size_t rgba_bytes(const GLsizei& width, const GLsizei& height) {
+    return (size_t) width * height * 4;
+}
+
+static bool write_rgba(TextureStreamer& streamer,
+                       const Texture& texture,
+                       const GLint& y,
+                       const GLsizei& height,
+                       const uint32_t& color) {
+    std::vector<uint32_t> pixels(8 * height, color);
+    return streamer.write(texture, 0, y, 8, height, GL_RGBA,
+                          GL_UNSIGNED_BYTE, pixels.data());
+}
+
+// Waits for the GPU and lets the streamer see it
+static void finish(TextureStreamer& streamer) {
+    glFinish();
+    streamer.flush();
+}
+
+TEST_CASE("texture streams are created when first written",
+          "[texture_streamer]") {
+    GLTestContext gl;
+    Texture texture(GL_TEXTURE_2D, 8, 8);
+    glTextureStorage2D(texture.id, 1, GL_RGBA8, 8, 8);
+
+    TextureStreamer streamer(rgba_bytes(8, 8));
+    streamer.flush();
+    REQUIRE_FALSE(streamer.is_created());
+
+    // The first write asks for the buffer, and the next frame has it
+    REQUIRE_FALSE(write_rgba(streamer, texture, 0, 8, 0xff0000ffu));
+    streamer.flush();
+    REQUIRE(streamer.is_created());
+    REQUIRE(write_rgba(streamer, texture, 0, 8, 0xff0000ffu));
+    REQUIRE(streamer.flush() == rgba_bytes(8, 8));
+
+    streamer.destroy();
+    REQUIRE_FALSE(streamer.is_created());
+}
+
+TEST_CASE("texture streams wrap around", "[texture_streamer]") {
+    GLTestContext gl;
+    Texture texture(GL_TEXTURE_2D, 8, 8);
+    glTextureStorage2D(texture.id, 1, GL_RGBA8, 8, 8);
+
+    // Four 8x2 rows of 64 bytes each fill the ring exactly
+    TextureStreamer streamer(rgba_bytes(8, 8));
+    streamer.create();
+    REQUIRE(streamer.capacity() == rgba_bytes(8, 8));
+
+    // A takes [0, 128) and is retired by the flush that issues B
+    REQUIRE(write_rgba(streamer, texture, 0, 4, 0xff000001u));
+    streamer.flush();
+    glFinish();
+    REQUIRE(write_rgba(streamer, texture, 4, 2, 0xff000002u));
+    streamer.flush();
+    REQUIRE(streamer.bytes_used() == rgba_bytes(8, 2));
+
+    // B holds [128, 192), so C does not fit before the end; it starts over
+    // at 0 and also holds the 64 bytes it skipped
+    REQUIRE(write_rgba(streamer, texture, 0, 4, 0xff000003u));
+    REQUIRE(streamer.bytes_used() == rgba_bytes(8, 8));
+
+    // The ring is full until B and C have been read
+    REQUIRE_FALSE(write_rgba(streamer, texture, 6, 2, 0xff000004u));
+    finish(streamer);
+    REQUIRE(streamer.bytes_used() == rgba_bytes(8, 6));
+    finish(streamer);
+    REQUIRE(streamer.bytes_used() == 0);
+
+    // C was read from the start of the ring and B from past A
+    std::vector<uint32_t> pixels(8 * 8);
+    glGetTextureImage(texture.id, 0, GL_RGBA, GL_UNSIGNED_BYTE,
+                      (GLsizei)(pixels.size() * 4), pixels.data());
+    REQUIRE(pixels[0] == 0xff000003u);
+    REQUIRE(pixels[4 * 8 - 1] == 0xff000003u);
+    REQUIRE(pixels[4 * 8] == 0xff000002u);
+    REQUIRE(pixels[6 * 8 - 1] == 0xff000002u);
+
+    // Once empty the ring starts at 0 again, so the whole of it fits
+    REQUIRE(write_rgba(streamer, texture, 0, 8, 0xff000005u));
+    finish(streamer);
+    finish(streamer);
+    REQUIRE(streamer.bytes_used() == 0);
+
+    glGetTextureImage(texture.id, 0, GL_RGBA, GL_UNSIGNED_BYTE,
+                      (GLsizei)(pixels.size() * 4), pixels.data());
+    REQUIRE(pixels[0] == 0xff000005u);
+    REQUIRE(pixels[63] == 0xff000005u);
+
+    streamer.destroy();
+}
+
+#endif
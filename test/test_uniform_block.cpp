@@ -0,0 +1,111 @@
+//
+// ChameleonGL - A small framework for OpenGL.
+// Copyright (C) 2012-2017 Srinivas Kaza
+//
+// This file is part of ChameleonGL.
+//
+// ChameleonGL is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ChameleonGL is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ChameleonGL.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+
+#include <vector>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "catch.hpp"
+
+#include "uniform_block.hpp"
+
+TEST_CASE("uniform block layouts write through their offsets",
+          "[uniform_block]") {
+    // What a driver reports for
+    //
+    //     layout(std140) uniform lights {
+    //         vec3 color;
+    //         float intensity;
+    //         mat3 rotation;
+    //         vec4 positions[2];
+    //     };
+    UniformBlockLayout layout("lights", 112, {
+        UniformBlockMember({"positions", GL_FLOAT_VEC4, 64, 2, 16, 0}),
+        UniformBlockMember({"rotation", GL_FLOAT_MAT3, 16, 1, 0, 16}),
+        UniformBlockMember({"intensity", GL_FLOAT, 12, 1, 0, 0}),
+        UniformBlockMember({"color", GL_FLOAT_VEC3, 0, 1, 0, 0})
+    });
+    std::vector<uint8_t> block(layout.size, 0);
+
+    SECTION("members are found by name") {
+        REQUIRE(layout.find("intensity") != nullptr);
+        REQUIRE(layout.find("intensity")->offset == 12);
+        REQUIRE(layout.find("missing") == nullptr);
+    }
+
+    SECTION("scalars and vectors land at their offsets") {
+        REQUIRE(layout.write(block.data(), "color", glm::vec3(1, 2, 3)));
+        REQUIRE(layout.write(block.data(), "intensity", 4.0f));
+
+        float values[4];
+        std::memcpy(values, block.data(), sizeof(values));
+        REQUIRE(values[0] == 1.0f);
+        REQUIRE(values[1] == 2.0f);
+        REQUIRE(values[2] == 3.0f);
+        REQUIRE(values[3] == 4.0f);
+    }
+
+    SECTION("matrix columns are padded to the matrix stride") {
+        REQUIRE(layout.write(block.data(), "rotation", glm::mat3(2.0f)));
+
+        float column[4];
+        for (int c = 0; c < 3; c++) {
+            std::memcpy(column, block.data() + 16 + c * 16, sizeof(column));
+            for (int r = 0; r < 3; r++) {
+                REQUIRE(column[r] == (r == c ? 2.0f : 0.0f));
+            }
+            REQUIRE(column[3] == 0.0f);
+        }
+    }
+
+    SECTION("array elements are addressed through the array stride") {
+        REQUIRE(layout.write(block.data(), "positions",
+                             glm::vec4(5, 6, 7, 8), 1));
+
+        float values[4];
+        std::memcpy(values, block.data() + 80, sizeof(values));
+        REQUIRE(values[0] == 5.0f);
+        REQUIRE(values[3] == 8.0f);
+    }
+
+    SECTION("mismatched writes are rejected") {
+        REQUIRE_FALSE(layout.write(block.data(), "missing", 1.0f));
+        REQUIRE_FALSE(layout.write(block.data(), "color", 1.0f));
+        REQUIRE_FALSE(layout.write(block.data(), "positions",
+                                   glm::vec4(0), 2));
+        REQUIRE(std::all_of(block.begin(), block.end(),
+        [](const uint8_t& b) {
+            return b == 0;
+        }));
+    }
+}
+
+TEST_CASE("the frame block matches its std140 layout", "[uniform_block]") {
+    REQUIRE(sizeof(FrameUniformBlock) == 224);
+    REQUIRE(offsetof(FrameUniformBlock, chml_projection) == 64);
+    REQUIRE(offsetof(FrameUniformBlock, chml_inverse_view_projection) == 128);
+    REQUIRE(offsetof(FrameUniformBlock, chml_viewport) == 192);
+    REQUIRE(offsetof(FrameUniformBlock, chml_origin) == 208);
+    REQUIRE(offsetof(FrameUniformBlock, chml_near) == 220);
+}
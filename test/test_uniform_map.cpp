@@ -0,0 +1,130 @@
+//
+// ChameleonGL - A small framework for OpenGL.
+// Copyright (C) 2012-2017 Srinivas Kaza
+//
+// This file is part of ChameleonGL.
+//
+// ChameleonGL is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ChameleonGL is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ChameleonGL.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include <string>
+
+#include "catch.hpp"
+
+#include "uniform_map.hpp"
+#include "gl_test_context.hpp"
+
+#ifdef CHML_HAVE_EGL
+
+static void build(Program& program, const std::string& source) {
+    program.compile_shader(source, GL_VERTEX_SHADER, false, true);
+    REQUIRE(program.link_program());
+}
+
+static glm::vec4 read_vec4(Program& program, const char* name) {
+    glm::vec4 value;
+    glGetUniformfv(program.id, glGetUniformLocation(program.id, name),
+                   &value[0]);
+    return value;
+}
+
+TEST_CASE("uniform maps apply to several programs", "[uniform_map]") {
+    GLTestContext gl;
+    Program first;
+    Program second;
+    build(first, "#version 430\n"
+          "uniform float offset;\n"
+          "uniform vec4 value;\n"
+          "void main() { gl_Position = value + vec4(offset); }\n");
+    build(second, "#version 430\n"
+          "uniform vec4 value;\n"
+          "void main() { gl_Position = value; }\n");
+
+    UniformMap map;
+    map.set("value", glm::vec4(1.0f, 2.0f, 3.0f, 4.0f));
+    map.set("offset", 0.5f);
+
+    // Alternating applies must keep using each program's own locations
+    for (int i = 0; i < 3; i++) {
+        map.set("value", glm::vec4((float) i));
+        map.apply(first, false);
+        map.apply(second, false);
+        REQUIRE(read_vec4(first, "value") == glm::vec4((float) i));
+        REQUIRE(read_vec4(second, "value") == glm::vec4((float) i));
+    }
+
+    // Changing a value does not need a new lookup
+    map.set("offset", 0.25f);
+    map.apply(first, false);
+    GLfloat offset = 0.0f;
+    glGetUniformfv(first.id, glGetUniformLocation(first.id, "offset"),
+                   &offset);
+    REQUIRE(offset == 0.25f);
+}
+
+TEST_CASE("uniform array elements are reflected", "[uniform_map]") {
+    GLTestContext gl;
+    Program program;
+    build(program, "#version 430\n"
+          "uniform vec4 lights[4];\n"
+          "void main() { gl_Position = lights[0] + lights[3]; }\n");
+
+    // Every element is in the table, so setting one asks the driver nothing
+    for (int i = 0; i < 4; i++) {
+        std::string name = "lights[" + std::to_string(i) + "]";
+        const ProgramResource* element =
+            ProgramReflection::find(program.get_reflection().uniforms,
+                                    intern_name(name));
+        REQUIRE(element != nullptr);
+        REQUIRE(element->location ==
+                glGetUniformLocation(program.id, name.c_str()));
+    }
+
+    UniformMap map;
+    map.set(std::string("lights[3]"), glm::vec4(3.0f));
+    map.apply(program);
+    REQUIRE(read_vec4(program, "lights[3]") == glm::vec4(3.0f));
+}
+
+
+TEST_CASE("uniform maps follow replaced programs", "[uniform_map]") {
+    GLTestContext gl;
+    Program program;
+    Program fresh;
+    build(program, "#version 430\n"
+          "uniform float offset;\n"
+          "uniform vec4 value;\n"
+          "void main() { gl_Position = value + vec4(offset); }\n");
+    build(fresh, "#version 430\n"
+          "uniform vec4 value;\n"
+          "void main() { gl_Position = value; }\n");
+
+    UniformMap map;
+    map.set("value"_u, glm::vec4(1.0f));
+    map.apply(program, false);
+
+    // Locations are resolved per link, not per GL name, which the driver
+    // may give to a different program later
+    uint64_t serial = program.get_link_serial();
+    REQUIRE(serial != 0);
+    program.replace(fresh);
+    REQUIRE(program.get_link_serial() != serial);
+
+    map.set("value"_u, glm::vec4(2.0f));
+    map.apply(program, false);
+    REQUIRE(read_vec4(program, "value") == glm::vec4(2.0f));
+}
+
+#endif
@@ -0,0 +1,87 @@
+//
+// ChameleonGL - A small framework for OpenGL.
+// Copyright (C) 2012-2017 Srinivas Kaza
+//
+// This file is part of ChameleonGL.
+//
+// ChameleonGL is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// ChameleonGL is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with ChameleonGL.  If not, see <http://www.gnu.org/licenses/>.
+//
+
+
+#include <iostream>
+#include <string>
+#include <sys/stat.h>
+
+#include "chameleon_gl.hpp"
+#include "mesh.hpp"
+#include "mesh_file.hpp"
+
+STATIC_INIT()
+
+// Converts an OBJ file to the binary format read by Mesh::load, offline.
+//
+//   obj_to_mesh [--meshlets] input.obj [output.mesh]
+//
+// The output defaults to the cache file Mesh::load would write itself.
+int main(int argc, char** args) {
+    bool meshlets = false;
+    std::string input;
+    std::string output;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = args[i];
+        if (arg == "--meshlets") {
+            meshlets = true;
+        } else if (input.empty()) {
+            input = arg;
+        } else if (output.empty()) {
+            output = arg;
+        } else {
+            input.clear();
+            break;
+        }
+    }
+
+    if (input.empty()) {
+        std::cerr << "usage: " << args[0]
+                  << " [--meshlets] input.obj [output.mesh]" << std::endl;
+        return 1;
+    }
+    if (output.empty()) {
+        output = input + MESH_EXTENSION;
+    }
+
+    struct stat st;
+    if (stat(input.c_str(), &st) != 0) {
+        std::cerr << "Could not find " << input << std::endl;
+        return 1;
+    }
+
+    MeshData data;
+    try {
+        data = Mesh::parse_obj(input, meshlets);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    if (!MeshFile::write(output, data, st.st_size, st.st_mtime)) {
+        std::cerr << "Could not write " << output << std::endl;
+        return 1;
+    }
+
+    std::cout << output << ": " << data.num_vertices << " vertices, "
+              << data.num_indices << " indices, "
+              << data.meshlets.size() << " meshlets" << std::endl;
+    return 0;
+}